@@ -0,0 +1,783 @@
+//
+//  main.cpp
+//  myoosc-bench
+//
+//  Microbenchmarks of the DataSender callbacks, with fixed destinations and
+//  with subscriptions, OSC encoding and parsing, device lookup, Euler angles,
+//  the EMG envelope, spectrum and gesture classifier, the latency and latest value stores,
+//  verbose logging and tracing. Every result is printed as one JSON object
+//  per line:
+//
+//    {"label":"...","name":"sender/onEmgData/arm","iterations":...,"ns_per_op":...,
+//     "allocs_per_op":...,"bytes_per_op":...}
+//
+//  where bytes_per_op is the UDP payload sent, or the size of the encoded
+//  packet. The bundling benchmarks also report datagrams_per_op. Messages
+//  go to a UDP socket bound on localhost that is never read, so the suite
+//  runs offline. Doesn't need a Myo or Myo Connect; on Linux it builds
+//  like the load generator, with bench/main.cpp in place of
+//  loadgen/main.cpp.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ip/UdpSocket.h"
+#include "osc/OscOutboundPacketStream.h"
+#include "osc/OscReceivedElements.h"
+#include "NullOStream.h"
+#include "DataSender.h"
+#include "DeviceManager.h"
+#include "EmgEnvelope.h"
+#include "EmgSpectrum.h"
+#include "Euler.h"
+#include "GestureModel.h"
+#include "LatencyHistogram.h"
+#include "LatestValues.h"
+#include "Logger.h"
+#include "MessageTemplate.h"
+#include "PacketBuilder.h"
+#include "Settings.h"
+#include "Subscriptions.h"
+#include "Trace.h"
+
+static std::atomic<std::uint64_t> allocations(0);
+
+// Every allocation is counted by replacing the global operators. The two
+// primary ones stay out of line: once GCC inlines them into library code it
+// no longer sees that free() releases what malloc() returned, and warns
+// about mismatched new and delete.
+#if defined(__GNUC__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+BENCH_NOINLINE void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+BENCH_NOINLINE void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+// The other forms forward to the two above, like the library's own, so
+// that every allocation is released by the function paired with the one
+// that made it.
+void operator delete[](void* p) noexcept {
+  operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+  operator delete[](p);
+}
+
+static const char usageText[] =
+"USAGE: myoosc-bench [--filter=<text>] [--min-time=<seconds>] [--label=<text>] [--port=<n>] [MyoOsc2 options]\n"
+"   Runs the benchmarks whose name contains <text> (all by default), each for\n"
+"   at least <seconds> (default 0.2), and prints one JSON line per result,\n"
+"   tagged with <label>. Sends to a sink on localhost:<n> (default 57777).\n"
+"   The DataSender benchmarks always run with --sync, so that they measure\n"
+"   encoding and sending as well.\n";
+
+// Takes the option off the command line if it is there.
+static bool takeOption(std::vector<char*>& args, const std::string& name, std::string& value) {
+  for (auto it = args.begin() + 1; it != args.end(); ++it) {
+    std::string arg = *it;
+    if (arg == name || arg.compare(0, name.size() + 1, name + "=") == 0) {
+      value = arg.size() > name.size() ? arg.substr(name.size() + 1) : "";
+      args.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+static std::string jsonString(const std::string& text) {
+  std::string result = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+    }
+    result += c;
+  }
+  return result + "\"";
+}
+
+class Bench {
+public:
+  // Runs one operation. Returns the number of bytes it emitted.
+  using Op = std::function<std::size_t(std::uint64_t iteration)>;
+
+  Bench(std::string label, std::string filter, double minTime)
+  : _label(std::move(label))
+  , _filter(std::move(filter))
+  , _minTime(minTime) {}
+
+  // With a sender, also reports the number of datagrams it sent per op.
+  void run(const std::string& name, const Op& op, const DataSender* sender = nullptr) {
+    if (name.find(_filter) == std::string::npos) {
+      return;
+    }
+    // warm up, and find out how many iterations fill the minimum time
+    std::uint64_t iterations = 1;
+    double seconds = 0;
+    while (true) {
+      seconds = measure(op, iterations);
+      if (seconds >= _minTime) {
+        break;
+      }
+      iterations *= seconds > 0 ? std::min(10.0, std::max(2.0, 1.2 * _minTime / seconds)) : 10;
+    }
+    auto allocationsBefore = allocations.load(std::memory_order_relaxed);
+    auto datagramsBefore = sender ? sender->datagramsSent() : 0;
+    _bytes = 0;
+    seconds = measure(op, iterations);
+    auto allocated = allocations.load(std::memory_order_relaxed) - allocationsBefore;
+    auto datagrams = sender ? sender->datagramsSent() - datagramsBefore : 0;
+    std::cout << std::dec
+              << "{\"label\":" << jsonString(_label)
+              << ",\"name\":" << jsonString(name)
+              << ",\"iterations\":" << iterations
+              << ",\"ns_per_op\":" << seconds * 1e9 / iterations
+              << ",\"allocs_per_op\":" << static_cast<double>(allocated) / iterations
+              << ",\"bytes_per_op\":" << static_cast<double>(_bytes) / iterations;
+    if (sender) {
+      std::cout << ",\"datagrams_per_op\":" << static_cast<double>(datagrams) / iterations;
+    }
+    std::cout << "}" << std::endl;
+  }
+
+private:
+  double measure(const Op& op, std::uint64_t iterations) {
+    _bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (std::uint64_t i = 0; i < iterations; i++) {
+      _bytes += op(i);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  std::string _label;
+  std::string _filter;
+  double _minTime;
+  std::uint64_t _bytes;
+};
+
+// Opaque handles standing in for Myo objects, see SyntheticSource.
+static std::vector<char> handles(256);
+
+static MyoPtr handle(std::size_t i) {
+  return reinterpret_cast<MyoPtr>(&handles[i]);
+}
+
+static void benchSender(Bench& bench, const Settings& settings) {
+  Logger logger(settings);
+  DataPaths dataPaths(settings);
+  DeviceManager devices(dataPaths);
+  DataSender sender(devices, settings, dataPaths, logger);
+  auto myo = handle(0);
+  sender.onPair(myo, 0, myo::FirmwareVersion{1, 5, 1970, 2});
+
+  const myo::Quaternion<float> rotation(0.1f, 0.2f, 0.3f, 0.927f);
+  const myo::Vector3<float> vector(0.1f, -0.2f, 0.98f);
+  const std::int8_t emg[emgLength] = {1, -2, 3, -4, 5, -6, 7, -8};
+  const myo::Pose poses[2] = {myo::Pose::fist, myo::Pose::rest};
+
+  // timestamps keep increasing across benchmarks, for the EMG batch period
+  std::uint64_t time = 0;
+  auto sent = [&](std::uint64_t before) {
+    return static_cast<std::size_t>(sender.bytesSent() - before);
+  };
+  for (bool arm : {false, true}) {
+    if (arm) {
+      sender.onArmSync(myo, time, myo::armLeft, myo::xDirectionTowardWrist, 0, myo::warmupStateWarm);
+    } else {
+      sender.onArmUnsync(myo, time);
+    }
+    std::string suffix = arm ? "/arm" : "/noarm";
+    bench.run("sender/onOrientationData" + suffix, [&](std::uint64_t) {
+      auto before = sender.bytesSent();
+      sender.onOrientationData(myo, time += 20000, rotation);
+      return sent(before);
+    });
+    bench.run("sender/onAccelerometerData" + suffix, [&](std::uint64_t) {
+      auto before = sender.bytesSent();
+      sender.onAccelerometerData(myo, time += 20000, vector);
+      return sent(before);
+    });
+    bench.run("sender/onGyroscopeData" + suffix, [&](std::uint64_t) {
+      auto before = sender.bytesSent();
+      sender.onGyroscopeData(myo, time += 20000, vector);
+      return sent(before);
+    });
+    // one IMU sample as three callbacks, and as the single one the Hub makes
+    bench.run("sender/imuSeparate" + suffix, [&](std::uint64_t) {
+      auto before = sender.bytesSent();
+      time += 20000;
+      sender.onOrientationData(myo, time, rotation);
+      sender.onAccelerometerData(myo, time, vector);
+      sender.onGyroscopeData(myo, time, vector);
+      return sent(before);
+    });
+    bench.run("sender/onImuData" + suffix, [&](std::uint64_t) {
+      auto before = sender.bytesSent();
+      sender.onImuData(myo, time += 20000, rotation, vector, vector);
+      return sent(before);
+    });
+    bench.run("sender/onEmgData" + suffix, [&](std::uint64_t) {
+      auto before = sender.bytesSent();
+      sender.onEmgData(myo, time += 5000, emg);
+      return sent(before);
+    });
+    bench.run("sender/onRssi" + suffix, [&](std::uint64_t) {
+      auto before = sender.bytesSent();
+      sender.onRssi(myo, time += 1000, -60);
+      return sent(before);
+    });
+    bench.run("sender/onPose" + suffix, [&](std::uint64_t i) {
+      auto before = sender.bytesSent();
+      sender.onPose(myo, time += 1000, poses[i % 2]);
+      return sent(before);
+    });
+    bench.run("sender/onUnlock" + suffix, [&](std::uint64_t) {
+      auto before = sender.bytesSent();
+      sender.onUnlock(myo, time += 1000);
+      return sent(before);
+    });
+  }
+}
+
+// A second of one synced Myo, IMU at 50 Hz and EMG at 200 Hz, with each
+// event sent as separate messages and as one bundle.
+static void benchBundle(Bench& bench, Settings settings) {
+  const myo::Quaternion<float> rotation(0.1f, 0.2f, 0.3f, 0.927f);
+  const myo::Vector3<float> vector(0.1f, -0.2f, 0.98f);
+  const std::int8_t emg[emgLength] = {1, -2, 3, -4, 5, -6, 7, -8};
+  for (bool bundle : {false, true}) {
+    settings.bundle = bundle;
+    Logger logger(settings);
+    DataPaths dataPaths(settings);
+    DeviceManager devices(dataPaths);
+    DataSender sender(devices, settings, dataPaths, logger);
+    auto myo = handle(0);
+    sender.onPair(myo, 0, myo::FirmwareVersion{1, 5, 1970, 2});
+    sender.onArmSync(myo, 0, myo::armLeft, myo::xDirectionTowardWrist, 0, myo::warmupStateWarm);
+    std::uint64_t time = 0;
+    bench.run(std::string("bundle/second/") + (bundle ? "bundled" : "separate"), [&](std::uint64_t) {
+      auto before = sender.bytesSent();
+      for (int i = 0; i < 200; i++) {
+        time += 5000;
+        if (i % 4 == 0) {
+          sender.onImuData(myo, time, rotation, vector, vector);
+        }
+        sender.onEmgData(myo, time, emg);
+      }
+      return static_cast<std::size_t>(sender.bytesSent() - before);
+    }, &sender);
+  }
+}
+
+// The same callbacks with no fixed destination, for subscribers that want
+// nothing, just the EMG of the device, or everything.
+static void benchSubscriptions(Bench& bench, Settings settings) {
+  auto sink = settings.destinations.front();
+  settings.destinations.clear();
+  Logger logger(settings);
+  DataPaths dataPaths(settings);
+  DeviceManager devices(dataPaths);
+  Subscriptions subscriptions(Settings::maxDestinations, std::chrono::hours(1));
+  DataSender sender(devices, settings, dataPaths, logger, &subscriptions);
+  auto myo = handle(0);
+  sender.onPair(myo, 0, myo::FirmwareVersion{1, 5, 1970, 2});
+
+  const myo::Quaternion<float> rotation(0.1f, 0.2f, 0.3f, 0.927f);
+  const myo::Vector3<float> vector(0.1f, -0.2f, 0.98f);
+  const std::int8_t emg[emgLength] = {1, -2, 3, -4, 5, -6, 7, -8};
+  std::uint64_t time = 0;
+  IpEndpointName endpoint(sink.hostname.c_str(), sink.port);
+  const std::pair<const char*, const char*> cases[] = {
+    {"/none", ""},
+    {"/emg", "/myo/0/emg"},
+    {"/all", "/"},
+  };
+  for (const auto& c : cases) {
+    std::string suffix = c.first;
+    if (*c.second) {
+      subscriptions.subscribe(c.second, endpoint, Subscriptions::Clock::now());
+    }
+    bench.run("subscribed/onImuData" + suffix, [&](std::uint64_t) {
+      auto before = sender.bytesSent();
+      sender.onImuData(myo, time += 20000, rotation, vector, vector);
+      return static_cast<std::size_t>(sender.bytesSent() - before);
+    });
+    bench.run("subscribed/onEmgData" + suffix, [&](std::uint64_t) {
+      auto before = sender.bytesSent();
+      sender.onEmgData(myo, time += 5000, emg);
+      return static_cast<std::size_t>(sender.bytesSent() - before);
+    });
+  }
+  // what a new subscription costs per message template, once
+  const std::string pattern = "/myo/{0,1}/orient*/[xw]";
+  const std::string addresses[2] = {"/myo/1/orientVec/x", "/myo/1/emg/3"};
+  bench.run("subscribed/matchesAddressPattern", [&](std::uint64_t i) {
+    matchesAddressPattern(pattern, addresses[i % 2]);
+    return std::size_t(0);
+  });
+}
+
+static void benchEncode(Bench& bench) {
+  char buffer[1024];
+  osc::OutboundPacketStream packet(buffer, sizeof(buffer));
+  const char blob[emgLength] = {1, -2, 3, -4, 5, -6, 7, -8};
+
+  // one message with a single argument of each type
+  auto encode = [&](const std::string& name, std::function<void()> write) {
+    bench.run("encode/" + name, [&](std::uint64_t) {
+      packet.Clear();
+      packet << osc::BeginMessage("/myo/0/accel");
+      write();
+      packet << osc::EndMessage;
+      return packet.Size();
+    });
+  };
+  encode("int32", [&] { packet << static_cast<osc::int32>(42); });
+  encode("int64", [&] { packet << static_cast<osc::int64>(42); });
+  encode("float", [&] { packet << 0.5f; });
+  encode("double", [&] { packet << 0.5; });
+  encode("bool", [&] { packet << true; });
+  encode("char", [&] { packet << 'x'; });
+  encode("string", [&] { packet << "fingersSpread"; });
+  encode("symbol", [&] { packet << osc::Symbol("fingersSpread"); });
+  encode("blob", [&] { packet << osc::Blob(blob, sizeof(blob)); });
+  encode("timetag", [&] { packet << osc::TimeTag(1); });
+  encode("nil", [&] { packet << osc::OscNil; });
+  encode("ffff", [&] { packet << 0.1f << 0.2f << 0.3f << 0.927f; });
+
+  bench.run("encode/bundle", [&](std::uint64_t) {
+    packet.Clear();
+    packet << osc::BeginBundleImmediate;
+    packet << osc::BeginMessage("/myo/0/orientation") << 0.1f << 0.2f << 0.3f << 0.927f << osc::EndMessage;
+    packet << osc::BeginMessage("/myo/0/accel") << 0.1f << -0.2f << 0.98f << osc::EndMessage;
+    packet << osc::BeginMessage("/myo/0/gyro") << 1.0f << 2.0f << 3.0f << osc::EndMessage;
+    packet << osc::EndBundle;
+    return packet.Size();
+  });
+
+  // the same messages from pre-encoded templates, as the sender writes them
+  PacketBuilder builder(buffer, sizeof(buffer), sizeof(buffer));
+  const MessageTemplate int32Message("/myo/0/accel", "i");
+  const MessageTemplate floatMessage("/myo/0/accel", "f");
+  const MessageTemplate ffffMessage("/myo/0/accel", "ffff");
+  const MessageTemplate orientation("/myo/0/orientation", "ffff");
+  const MessageTemplate accel("/myo/0/accel", "fff");
+  const MessageTemplate gyro("/myo/0/gyro", "fff");
+  auto encodeTemplate = [&](const std::string& name, const MessageTemplate& message,
+                            std::function<void(char*)> write) {
+    bench.run("encode/template/" + name, [&](std::uint64_t) {
+      builder.clear();
+      write(builder.addMessage(message) + message.argumentOffset());
+      return builder.packetSize(0);
+    });
+  };
+  encodeTemplate("int32", int32Message, [](char* slot) {
+    writeOscArgument(slot, static_cast<std::int32_t>(42));
+  });
+  encodeTemplate("float", floatMessage, [](char* slot) { writeOscArgument(slot, 0.5f); });
+  encodeTemplate("ffff", ffffMessage, [](char* slot) {
+    slot = writeOscArgument(slot, 0.1f);
+    slot = writeOscArgument(slot, 0.2f);
+    slot = writeOscArgument(slot, 0.3f);
+    writeOscArgument(slot, 0.927f);
+  });
+  bench.run("encode/template/bundle", [&](std::uint64_t) {
+    builder.clear();
+    builder.beginBundle();
+    char* slot = builder.addMessage(orientation) + orientation.argumentOffset();
+    slot = writeOscArgument(slot, 0.1f);
+    slot = writeOscArgument(slot, 0.2f);
+    slot = writeOscArgument(slot, 0.3f);
+    writeOscArgument(slot, 0.927f);
+    slot = builder.addMessage(accel) + accel.argumentOffset();
+    slot = writeOscArgument(slot, 0.1f);
+    slot = writeOscArgument(slot, -0.2f);
+    writeOscArgument(slot, 0.98f);
+    slot = builder.addMessage(gyro) + gyro.argumentOffset();
+    slot = writeOscArgument(slot, 1.0f);
+    slot = writeOscArgument(slot, 2.0f);
+    writeOscArgument(slot, 3.0f);
+    builder.endBundle();
+    return builder.packetSize(0);
+  });
+}
+
+static void benchParse(Bench& bench) {
+  char messageBuffer[256];
+  osc::OutboundPacketStream message(messageBuffer, sizeof(messageBuffer));
+  message << osc::BeginMessage("/myo/0/orientation") << 0.1f << 0.2f << 0.3f << 0.927f << osc::EndMessage;
+
+  char bundleBuffer[512];
+  osc::OutboundPacketStream bundle(bundleBuffer, sizeof(bundleBuffer));
+  bundle << osc::BeginBundleImmediate;
+  bundle << osc::BeginMessage("/myo/0/orientation") << 0.1f << 0.2f << 0.3f << 0.927f << osc::EndMessage;
+  bundle << osc::BeginMessage("/myo/0/accel") << 0.1f << -0.2f << 0.98f << osc::EndMessage;
+  bundle << osc::BeginMessage("/myo/0/gyro") << 1.0f << 2.0f << 3.0f << osc::EndMessage;
+  bundle << osc::EndBundle;
+
+  // keeps the parsed values from being optimized away
+  volatile float sink = 0;
+  auto sumArguments = [&](const osc::ReceivedMessage& received) {
+    float sum = 0;
+    for (auto arg = received.ArgumentsBegin(); arg != received.ArgumentsEnd(); ++arg) {
+      sum += arg->AsFloat();
+    }
+    sink = sink + sum;
+  };
+
+  bench.run("parse/message", [&](std::uint64_t) {
+    osc::ReceivedPacket packet(message.Data(), message.Size());
+    sumArguments(osc::ReceivedMessage(packet));
+    return std::size_t(0);
+  });
+  bench.run("parse/bundle", [&](std::uint64_t) {
+    osc::ReceivedPacket packet(bundle.Data(), bundle.Size());
+    osc::ReceivedBundle received(packet);
+    for (auto element = received.ElementsBegin(); element != received.ElementsEnd(); ++element) {
+      sumArguments(osc::ReceivedMessage(*element));
+    }
+    return std::size_t(0);
+  });
+}
+
+static void benchDevices(Bench& bench, const Settings& settings) {
+  for (std::size_t count : {1, 8, 64, 256}) {
+    DataPaths dataPaths(settings);
+    DeviceManager devices(dataPaths);
+    for (std::size_t i = 0; i < count; i++) {
+      devices.registerDevice(handle(i));
+    }
+    bench.run("devices/registerDevice/" + std::to_string(count), [&](std::uint64_t i) {
+      // an already registered device, as for every event after the first
+      devices.registerDevice(handle(i % count));
+      return std::size_t(0);
+    });
+    bench.run("devices/reconnect/" + std::to_string(count), [&](std::uint64_t i) {
+      devices.unregisterDevice(handle(i % count));
+      devices.registerDevice(handle(i % count));
+      return std::size_t(0);
+    });
+  }
+}
+
+// Euler angles of one quaternion at a time, as the sender converts them,
+// and of batches. The exact mode is the standard library.
+static void benchEuler(Bench& bench) {
+  const std::size_t batch = 64;
+  std::vector<float> quats(4 * batch);
+  std::vector<float> euler(3 * batch);
+  for (std::size_t i = 0; i < batch; i++) {
+    float angle = 0.1f * static_cast<float>(i);
+    quats[4 * i] = 0.5f * std::sin(angle);
+    quats[4 * i + 1] = 0.5f * std::cos(angle);
+    quats[4 * i + 2] = 0.5f * std::sin(2 * angle);
+    quats[4 * i + 3] = std::sqrt(1 - 0.25f - 0.25f * std::sin(2 * angle) * std::sin(2 * angle));
+  }
+  const std::pair<const char*, EulerPrecision> modes[] = {
+    {"exact", EulerPrecision::exact},
+    {"fast", EulerPrecision::fast},
+  };
+  for (const auto& mode : modes) {
+    bench.run(std::string("euler/") + mode.first + "/1", [&](std::uint64_t i) {
+      quaternionsToEuler(&quats[4 * (i % batch)], euler.data(), 1, mode.second);
+      return std::size_t(0);
+    });
+    bench.run(std::string("euler/") + mode.first + "/64", [&](std::uint64_t) {
+      quaternionsToEuler(quats.data(), euler.data(), batch, mode.second);
+      return std::size_t(0);
+    });
+  }
+}
+
+static void benchEmgEnvelope(Bench& bench) {
+  std::vector<EmgArray> frames(256);
+  std::uint32_t value = 1;
+  for (auto& frame : frames) {
+    for (auto& sample : frame) {
+      value = value * 1664525 + 1013904223;
+      sample = static_cast<std::int8_t>(value >> 24);
+    }
+  }
+  for (std::size_t window : {40, 1000}) {
+    EmgEnvelope envelope(window, window);
+    bench.run("emgEnvelope/add/" + std::to_string(window), [&](std::uint64_t i) {
+      envelope.add(frames[i % frames.size()].data());
+      return std::size_t(0);
+    });
+  }
+  EmgEnvelope envelope(40, 10);
+  std::array<float, emgLength> rms;
+  std::array<float, emgLength> mav;
+  bench.run("emgEnvelope/values", [&](std::uint64_t i) {
+    envelope.add(frames[i % frames.size()].data());
+    envelope.rms(rms.data());
+    envelope.meanAbsolute(mav.data());
+    return std::size_t(0);
+  });
+}
+
+// One analysis of all 8 channels, as the worker thread runs it every few
+// frames of a device.
+static void benchEmgSpectrum(Bench& bench) {
+  std::vector<EmgArray> frames(Settings::maxEmgSpectrumFrames);
+  std::uint32_t value = 1;
+  for (auto& frame : frames) {
+    for (auto& sample : frame) {
+      value = value * 1664525 + 1013904223;
+      sample = static_cast<std::int8_t>(value >> 24);
+    }
+  }
+  for (std::size_t window : {64, 128, 512}) {
+    EmgSpectrum spectrum(window, window, [] {});
+    EmgSpectrum::Result result;
+    bench.run("emgSpectrum/analyze/" + std::to_string(window), [&](std::uint64_t i) {
+      spectrum.analyze(frames.data(), i % window, result);
+      return std::size_t(0);
+    });
+  }
+}
+
+// A model of 8 gestures with arbitrary weights: one prediction from the
+// features of a window, and the sender classifying the EMG of 64 devices,
+// one frame of each per op.
+static void benchGesture(Bench& bench, Settings settings) {
+  const std::size_t classes = 8;
+  std::vector<std::string> names;
+  std::vector<float> weights;
+  std::vector<float> biases;
+  std::uint32_t value = 1;
+  auto random = [&] {
+    value = value * 1664525 + 1013904223;
+    return static_cast<float>(value >> 8) / (1 << 24) - 0.5f;
+  };
+  for (std::size_t c = 0; c < classes; c++) {
+    names.push_back("gesture" + std::to_string(c));
+    biases.push_back(random());
+    for (std::size_t i = 0; i < GestureModel::numFeatures; i++) {
+      weights.push_back(random() * 0.1f);
+    }
+  }
+  GestureModel model(40, 10, names, weights, biases);
+  std::array<float, GestureModel::numFeatures> features;
+  for (auto& feature : features) {
+    feature = 20 + 20 * random();
+  }
+  volatile std::int32_t sink = 0;
+  bench.run("gesture/predict", [&](std::uint64_t i) {
+    features[i % features.size()] += 0.01f;
+    sink = sink + model.predict(features.data()).gesture;
+    return std::size_t(0);
+  });
+
+  // only sets up the gesture paths, the model is the one above. Nothing is
+  // sent while no device is synced to an arm, so the difference between the
+  // two is the cost of classifying.
+  settings.gestureModelFile = "bench";
+  settings.destinations = {{"127.0.0.1", settings.destinations[0].port, "/arm/"}};
+  std::vector<EmgArray> frames(256);
+  for (auto& frame : frames) {
+    for (auto& sample : frame) {
+      sample = static_cast<std::int8_t>(random() * 200);
+    }
+  }
+  const std::size_t count = 64;
+  for (bool classify : {false, true}) {
+    Logger logger(settings);
+    DataPaths dataPaths(settings);
+    DeviceManager devices(dataPaths);
+    DataSender sender(devices, settings, dataPaths, logger, nullptr, classify ? &model : nullptr);
+    for (std::size_t d = 0; d < count; d++) {
+      sender.onPair(handle(d), 0, myo::FirmwareVersion{1, 5, 1970, 2});
+    }
+    std::uint64_t time = 0;
+    bench.run(std::string("gesture/64devices/") + (classify ? "model" : "none"), [&](std::uint64_t i) {
+      time += 5000;
+      for (std::size_t d = 0; d < count; d++) {
+        sender.onEmgData(handle(d), time, frames[(i + d) % frames.size()].data());
+      }
+      return std::size_t(0);
+    });
+  }
+}
+
+static void benchLatency(Bench& bench) {
+  LatencyHistogram histogram;
+  // spread over a few decades, like real latencies
+  std::vector<std::uint64_t> values(1024);
+  std::uint64_t value = 1;
+  for (auto& v : values) {
+    value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+    v = 1000 + (value >> 40) % 10000000;
+  }
+  bench.run("latency/record", [&](std::uint64_t i) {
+    histogram.record(values[i % values.size()]);
+    return std::size_t(0);
+  });
+  volatile std::uint64_t sink = 0;
+  bench.run("latency/percentile", [&](std::uint64_t) {
+    sink = sink + histogram.percentile(99);
+    return std::size_t(0);
+  });
+}
+
+// Verbose logging calls as the sender makes them, with the background thread
+// writing to a stream that discards everything. What it can't keep up with
+// is dropped, which costs about the same on the calling side.
+static void benchLogger(Bench& bench, Settings settings) {
+  settings.verbose = true;
+  NulOStream discard;
+  Logger logger(settings, discard);
+  DataPaths dataPaths(settings);
+  const auto& paths = dataPaths[0];
+  const myo::Quaternion<float> rotation(0.1f, 0.2f, 0.3f, 0.927f);
+  const std::int8_t emg[emgLength] = {1, -2, 3, -4, 5, -6, 7, -8};
+  bench.run("logger/verboseMessage/float", [&](std::uint64_t i) {
+    logger.verboseMessage(paths.armRotation.address(), static_cast<float>(i));
+    return std::size_t(0);
+  });
+  bench.run("logger/verboseMessage/quaternion", [&](std::uint64_t) {
+    logger.verboseMessage(paths.orientQuat, rotation);
+    return std::size_t(0);
+  });
+  bench.run("logger/verboseMessage/emg", [&](std::uint64_t) {
+    logger.verboseMessage(paths.emg, emg);
+    return std::size_t(0);
+  });
+  logger.flush();
+}
+
+static void benchLatest(Bench& bench) {
+  LatestValues latest;
+  const float quat[4] = {0.1f, 0.2f, 0.3f, 0.927f};
+  const float vec[3] = {0.1f, -0.2f, 0.98f};
+  const std::int8_t emg[emgLength] = {1, -2, 3, -4, 5, -6, 7, -8};
+  bench.run("latest/setImu", [&](std::uint64_t i) {
+    latest.setImu(i % 8, i, quat, vec, vec);
+    return std::size_t(0);
+  });
+  bench.run("latest/setEmg", [&](std::uint64_t i) {
+    latest.setEmg(i % 8, i, emg);
+    return std::size_t(0);
+  });
+  LatestValues::Snapshot snapshot;
+  bench.run("latest/snapshot", [&](std::uint64_t i) {
+    latest.snapshot(i % 8, snapshot);
+    return std::size_t(0);
+  });
+  // while the Myo event thread keeps updating the same device
+  std::atomic<bool> writing(true);
+  std::thread writer([&] {
+    for (std::uint64_t i = 0; writing.load(std::memory_order_relaxed); i++) {
+      latest.setImu(0, i, quat, vec, vec);
+    }
+  });
+  bench.run("latest/snapshot/contended", [&](std::uint64_t) {
+    latest.snapshot(0, snapshot);
+    return std::size_t(0);
+  });
+  writing = false;
+  writer.join();
+}
+
+// Trace points while tracing is off and on. Runs last, since tracing stays
+// on once enabled.
+static void benchTrace(Bench& bench) {
+  bench.run("trace/span/off", [&](std::uint64_t i) {
+    TraceSpan span("encode", static_cast<std::uint32_t>(i % 8), EventType::emg);
+    return std::size_t(0);
+  });
+  Trace::enable(65536);
+  bench.run("trace/span/on", [&](std::uint64_t i) {
+    TraceSpan span("encode", static_cast<std::uint32_t>(i % 8), EventType::emg);
+    return std::size_t(0);
+  });
+  bench.run("trace/counter/on", [&](std::uint64_t i) {
+    Trace::counter("sender queue", static_cast<std::int64_t>(i % 64));
+    return std::size_t(0);
+  });
+}
+
+int main(int argc, char * argv[]) {
+  std::vector<char*> args(argv, argv + argc);
+  std::string filter;
+  std::string label;
+  std::string value;
+  double minTime = 0.2;
+  int port = 57777;
+  takeOption(args, "--filter", filter);
+  takeOption(args, "--label", label);
+  if (takeOption(args, "--min-time", value)) {
+    minTime = std::strtod(value.c_str(), nullptr);
+  }
+  if (takeOption(args, "--port", value)) {
+    port = std::atoi(value.c_str());
+  }
+  if (minTime <= 0 || port <= 0 || port > 65535) {
+    std::cerr << usageText;
+    return 1;
+  }
+
+  Settings settings;
+  if (!settings.parseArgs(static_cast<int>(args.size()), args.data())) {
+    std::cerr << '\n' << usageText;
+    return 1;
+  }
+  settings.logging = false;
+  settings.senderThread = false;
+  settings.statsInterval = 0;
+  settings.destinations = {{"127.0.0.1", port, ""}};
+
+  try {
+    UdpReceiveSocket sink(IpEndpointName("127.0.0.1", port));
+    Bench bench(label, filter, minTime);
+    benchSender(bench, settings);
+    benchBundle(bench, settings);
+    benchSubscriptions(bench, settings);
+    benchEncode(bench);
+    benchParse(bench);
+    benchDevices(bench, settings);
+    benchEuler(bench);
+    benchEmgEnvelope(bench);
+    benchEmgSpectrum(bench);
+    benchGesture(bench, settings);
+    benchLatency(bench);
+    benchLogger(bench, settings);
+    benchLatest(bench);
+    benchTrace(bench);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
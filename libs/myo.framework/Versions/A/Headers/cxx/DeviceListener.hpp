@@ -50,6 +50,39 @@ struct FirmwareVersion {
     unsigned int firmwareVersionHardwareRev; ///< Myo's hardware revision; not used to detect firmware version mismatch.
 };
 
+/// An event about a Myo, with all of its data read out of libmyo.
+/// Only the member of \a data that matches \a type is set.
+struct DeviceEvent {
+    libmyo_event_type_t type; ///< Type of the event.
+    uint64_t timestamp;       ///< Timestamp of the event, in microseconds.
+
+    union Data {
+        /// Set for libmyo_event_paired and libmyo_event_connected.
+        FirmwareVersion firmwareVersion;
+
+        /// Set for libmyo_event_arm_synced.
+        struct ArmSync {
+            Arm arm;
+            XDirection xDirection;
+            float rotation;
+            WarmupState warmupState;
+        } armSync;
+
+        /// Set for libmyo_event_orientation.
+        struct Imu {
+            float orientation[4]; ///< Unit quaternion as x, y, z, w.
+            float accel[3];       ///< Accelerometer data in units of g.
+            float gyro[3];        ///< Gyroscope data in units of deg/s.
+        } imu;
+
+        Pose::Type pose;           ///< Set for libmyo_event_pose.
+        int8_t rssi;               ///< Set for libmyo_event_rssi.
+        uint8_t batteryLevel;      ///< Set for libmyo_event_battery_level.
+        int8_t emg[8];             ///< Set for libmyo_event_emg.
+        WarmupResult warmupResult; ///< Set for libmyo_event_warmup_completed.
+    } data;
+};
+
 /// A DeviceListener receives events about a Myo.
 /// @see Hub::addListener()
 class DeviceListener {
@@ -136,6 +169,19 @@ public:
     /// @param rotation The orientation data of \a myo, as a Quaternion.
     virtual void onOrientationData(Myo* myo, uint64_t timestamp, const Quaternion<float>& rotation) {}
 
+    /// Called when a paired Myo has provided new orientation, accelerometer and gyroscope data, which it always
+    /// does together. The default implementation calls onOrientationData(), onAccelerometerData() and
+    /// onGyroscopeData() in turn; override it to handle the three at once.
+    /// @param myo The Myo for this event.
+    /// @param timestamp The timestamp of when the event is received by the SDK. Timestamps are 64 bit unsigned
+    /// integers that correspond to a number of microseconds since some (unspecified) period in time. Timestamps
+    /// are monotonically non-decreasing.
+    /// @param rotation The orientation data of \a myo, as a Quaternion.
+    /// @param accel The accelerometer data of \a myo, in units of g.
+    /// @param gyro The gyroscope data of \a myo, in units of deg/s.
+    virtual void onImuData(Myo* myo, uint64_t timestamp, const Quaternion<float>& rotation,
+                           const Vector3<float>& accel, const Vector3<float>& gyro);
+
     /// Called when a paired Myo has provided new accelerometer data in units of g.
     /// @param myo The Myo for this event.
     /// @param timestamp The timestamp of when the event is received by the SDK. Timestamps are 64 bit unsigned
@@ -187,6 +233,12 @@ public:
     /// @param warmupResult The warmup result of \a myo.
     virtual void onWarmupCompleted(myo::Myo* myo, uint64_t timestamp, WarmupResult warmupResult) {}
 
+    /// Called for every event about a Myo, with the event already decoded. The default implementation calls the
+    /// callback for the type of the event.
+    /// @param myo The Myo for this event.
+    /// @param event The event.
+    virtual void onEvent(Myo* myo, const DeviceEvent& event);
+
     /// @cond LIBMYO_INTERNALS
 
     virtual void onOpaqueEvent(libmyo_event_t event) {}
@@ -195,3 +247,5 @@ public:
 };
 
 } // namespace myo
+
+#include "impl/DeviceListener_impl.hpp"
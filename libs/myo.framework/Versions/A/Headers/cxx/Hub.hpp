@@ -2,6 +2,7 @@
 // Distributed under the Myo SDK license agreement. See LICENSE.txt for details.
 #pragma once
 
+#include <unordered_map>
 #include <vector>
 
 #include <myo/libmyo.h>
@@ -10,6 +11,7 @@ namespace myo {
 
 class Myo;
 class DeviceListener;
+struct DeviceEvent;
 
 /// @brief A Hub provides access to one or more Myo instances.
 class Hub {
@@ -66,12 +68,17 @@ public:
 protected:
     void onDeviceEvent(libmyo_event_t event);
 
+    /// Read everything the listeners need out of a libmyo event, so that it is done once for all of them.
+    static void decodeEvent(libmyo_event_t event, DeviceEvent& decoded);
+
     Myo* lookupMyo(libmyo_myo_t opaqueMyo) const;
 
     Myo* addMyo(libmyo_myo_t opaqueMyo);
 
     libmyo_hub_t _hub;
     std::vector<Myo*> _myos;
+    // _myos by libmyo object, so that events find their Myo in constant time
+    std::unordered_map<libmyo_myo_t, Myo*> _myosByObject;
     std::vector<DeviceListener*> _listeners;
 
     /// @endcond
@@ -32,6 +32,9 @@ class Quaternion {
     {
     }
 
+    /// Construct a copy of the other quaternion.
+    Quaternion(const Quaternion& other) = default;
+
     /// Set the components of this quaternion to be those of the other.
     Quaternion& operator=(const Quaternion other)
     {
@@ -18,6 +18,7 @@ inline
 Hub::Hub(const std::string& applicationIdentifier)
 : _hub(0)
 , _myos()
+, _myosByObject()
 , _listeners()
 {
     libmyo_init_hub(&_hub, applicationIdentifier.c_str(), ThrowOnError());
@@ -110,95 +111,70 @@ void Hub::onDeviceEvent(libmyo_event_t event)
         return;
     }
 
+    DeviceEvent decoded;
+    decodeEvent(event, decoded);
+
     for (std::vector<DeviceListener*>::iterator I = _listeners.begin(), IE = _listeners.end(); I != IE; ++I) {
         DeviceListener* listener = *I;
 
         listener->onOpaqueEvent(event);
+        listener->onEvent(myo, decoded);
+    }
+}
 
-        uint64_t time = libmyo_event_get_timestamp(event);
-
-        switch (libmyo_event_get_type(event)) {
-        case libmyo_event_paired: {
-            FirmwareVersion version = {libmyo_event_get_firmware_version(event, libmyo_version_major),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_minor),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_patch),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_hardware_rev)};
-            listener->onPair(myo, time, version);
-            break;
-        }
-        case libmyo_event_unpaired:
-            listener->onUnpair(myo, time);
-            break;
-        case libmyo_event_connected: {
-            FirmwareVersion version = {libmyo_event_get_firmware_version(event, libmyo_version_major),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_minor),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_patch),
-                                       libmyo_event_get_firmware_version(event, libmyo_version_hardware_rev)};
-            listener->onConnect(myo, time, version);
-            break;
-        }
-        case libmyo_event_disconnected:
-            listener->onDisconnect(myo, time);
-            break;
-        case libmyo_event_arm_synced:
-            listener->onArmSync(myo, time,
-                                static_cast<Arm>(libmyo_event_get_arm(event)),
-                                static_cast<XDirection>(libmyo_event_get_x_direction(event)),
-                                libmyo_event_get_rotation_on_arm(event),
-                                static_cast<WarmupState>(libmyo_event_get_warmup_state(event)));
-            break;
-        case libmyo_event_arm_unsynced:
-            listener->onArmUnsync(myo, time);
-            break;
-        case libmyo_event_unlocked:
-            listener->onUnlock(myo, time);
-            break;
-        case libmyo_event_locked:
-            listener->onLock(myo, time);
-            break;
-        case libmyo_event_orientation:
-            listener->onOrientationData(myo, time,
-                                        Quaternion<float>(libmyo_event_get_orientation(event, libmyo_orientation_x),
-                                                          libmyo_event_get_orientation(event, libmyo_orientation_y),
-                                                          libmyo_event_get_orientation(event, libmyo_orientation_z),
-                                                          libmyo_event_get_orientation(event, libmyo_orientation_w)));
-            listener->onAccelerometerData(myo, time,
-                                          Vector3<float>(libmyo_event_get_accelerometer(event, 0),
-                                                         libmyo_event_get_accelerometer(event, 1),
-                                                         libmyo_event_get_accelerometer(event, 2)));
-
-            listener->onGyroscopeData(myo, time,
-                                      Vector3<float>(libmyo_event_get_gyroscope(event, 0),
-                                                     libmyo_event_get_gyroscope(event, 1),
-                                                     libmyo_event_get_gyroscope(event, 2)));
-
-            break;
-        case libmyo_event_pose:
-            listener->onPose(myo, time, Pose(static_cast<Pose::Type>(libmyo_event_get_pose(event))));
-            break;
-        case libmyo_event_rssi:
-            listener->onRssi(myo, time, libmyo_event_get_rssi(event));
-            break;
-        case libmyo_event_battery_level:
-            listener->onBatteryLevelReceived(myo, time, libmyo_event_get_battery_level(event));
-            break;
-        case libmyo_event_emg: {
-            int8_t emg[] = { libmyo_event_get_emg(event, 0),
-                             libmyo_event_get_emg(event, 1),
-                             libmyo_event_get_emg(event, 2),
-                             libmyo_event_get_emg(event, 3),
-                             libmyo_event_get_emg(event, 4),
-                             libmyo_event_get_emg(event, 5),
-                             libmyo_event_get_emg(event, 6),
-                             libmyo_event_get_emg(event, 7) };
-            listener->onEmgData(myo, time, emg);
-            break;
-        }
-        case libmyo_event_warmup_completed: {
-            listener->onWarmupCompleted(myo, time, static_cast<WarmupResult>(libmyo_event_get_warmup_result(event)));
-            break;
+inline
+void Hub::decodeEvent(libmyo_event_t event, DeviceEvent& decoded)
+{
+    decoded.type = static_cast<libmyo_event_type_t>(libmyo_event_get_type(event));
+    decoded.timestamp = libmyo_event_get_timestamp(event);
+
+    DeviceEvent::Data& data = decoded.data;
+
+    switch (decoded.type) {
+    case libmyo_event_paired:
+    case libmyo_event_connected: {
+        FirmwareVersion version = {libmyo_event_get_firmware_version(event, libmyo_version_major),
+                                   libmyo_event_get_firmware_version(event, libmyo_version_minor),
+                                   libmyo_event_get_firmware_version(event, libmyo_version_patch),
+                                   libmyo_event_get_firmware_version(event, libmyo_version_hardware_rev)};
+        data.firmwareVersion = version;
+        break;
+    }
+    case libmyo_event_arm_synced:
+        data.armSync.arm = static_cast<Arm>(libmyo_event_get_arm(event));
+        data.armSync.xDirection = static_cast<XDirection>(libmyo_event_get_x_direction(event));
+        data.armSync.rotation = libmyo_event_get_rotation_on_arm(event);
+        data.armSync.warmupState = static_cast<WarmupState>(libmyo_event_get_warmup_state(event));
+        break;
+    case libmyo_event_orientation:
+        data.imu.orientation[0] = libmyo_event_get_orientation(event, libmyo_orientation_x);
+        data.imu.orientation[1] = libmyo_event_get_orientation(event, libmyo_orientation_y);
+        data.imu.orientation[2] = libmyo_event_get_orientation(event, libmyo_orientation_z);
+        data.imu.orientation[3] = libmyo_event_get_orientation(event, libmyo_orientation_w);
+        for (unsigned int i = 0; i < 3; ++i) {
+            data.imu.accel[i] = libmyo_event_get_accelerometer(event, i);
+            data.imu.gyro[i] = libmyo_event_get_gyroscope(event, i);
         }
+        break;
+    case libmyo_event_pose:
+        data.pose = static_cast<Pose::Type>(libmyo_event_get_pose(event));
+        break;
+    case libmyo_event_rssi:
+        data.rssi = libmyo_event_get_rssi(event);
+        break;
+    case libmyo_event_battery_level:
+        data.batteryLevel = libmyo_event_get_battery_level(event);
+        break;
+    case libmyo_event_emg:
+        for (unsigned int i = 0; i < 8; ++i) {
+            data.emg[i] = libmyo_event_get_emg(event, i);
         }
+        break;
+    case libmyo_event_warmup_completed:
+        data.warmupResult = static_cast<WarmupResult>(libmyo_event_get_warmup_result(event));
+        break;
+    default:
+        break;
     }
 }
 
@@ -241,13 +217,8 @@ libmyo_hub_t Hub::libmyoObject()
 inline
 Myo* Hub::lookupMyo(libmyo_myo_t opaqueMyo) const
 {
-    Myo* myo = 0;
-    for (std::vector<Myo*>::const_iterator I = _myos.begin(), IE = _myos.end(); I != IE; ++I) {
-        if ((*I)->libmyoObject() == opaqueMyo) {
-            myo = *I;
-            break;
-        }
-    }
+    std::unordered_map<libmyo_myo_t, Myo*>::const_iterator I = _myosByObject.find(opaqueMyo);
+    Myo* myo = I != _myosByObject.end() ? I->second : 0;
 
     return myo;
 }
@@ -258,6 +229,7 @@ Myo* Hub::addMyo(libmyo_myo_t opaqueMyo)
     Myo* myo = new Myo(opaqueMyo);
 
     _myos.push_back(myo);
+    _myosByObject[opaqueMyo] = myo;
 
     return myo;
 }
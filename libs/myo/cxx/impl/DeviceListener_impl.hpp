@@ -0,0 +1,77 @@
+// Copyright (C) 2013-2014 Thalmic Labs Inc.
+// Distributed under the Myo SDK license agreement. See LICENSE.txt for details.
+#include "../DeviceListener.hpp"
+
+#include "../Pose.hpp"
+#include "../Quaternion.hpp"
+#include "../Vector3.hpp"
+
+namespace myo {
+
+inline
+void DeviceListener::onImuData(Myo* myo, uint64_t timestamp, const Quaternion<float>& rotation,
+                               const Vector3<float>& accel, const Vector3<float>& gyro)
+{
+    onOrientationData(myo, timestamp, rotation);
+    onAccelerometerData(myo, timestamp, accel);
+    onGyroscopeData(myo, timestamp, gyro);
+}
+
+inline
+void DeviceListener::onEvent(Myo* myo, const DeviceEvent& event)
+{
+    uint64_t time = event.timestamp;
+    const DeviceEvent::Data& data = event.data;
+
+    switch (event.type) {
+    case libmyo_event_paired:
+        onPair(myo, time, data.firmwareVersion);
+        break;
+    case libmyo_event_unpaired:
+        onUnpair(myo, time);
+        break;
+    case libmyo_event_connected:
+        onConnect(myo, time, data.firmwareVersion);
+        break;
+    case libmyo_event_disconnected:
+        onDisconnect(myo, time);
+        break;
+    case libmyo_event_arm_synced:
+        onArmSync(myo, time, data.armSync.arm, data.armSync.xDirection, data.armSync.rotation,
+                  data.armSync.warmupState);
+        break;
+    case libmyo_event_arm_unsynced:
+        onArmUnsync(myo, time);
+        break;
+    case libmyo_event_unlocked:
+        onUnlock(myo, time);
+        break;
+    case libmyo_event_locked:
+        onLock(myo, time);
+        break;
+    case libmyo_event_orientation:
+        onImuData(myo, time,
+                  Quaternion<float>(data.imu.orientation[0], data.imu.orientation[1],
+                                    data.imu.orientation[2], data.imu.orientation[3]),
+                  Vector3<float>(data.imu.accel[0], data.imu.accel[1], data.imu.accel[2]),
+                  Vector3<float>(data.imu.gyro[0], data.imu.gyro[1], data.imu.gyro[2]));
+        break;
+    case libmyo_event_pose:
+        onPose(myo, time, Pose(data.pose));
+        break;
+    case libmyo_event_rssi:
+        onRssi(myo, time, data.rssi);
+        break;
+    case libmyo_event_battery_level:
+        onBatteryLevelReceived(myo, time, data.batteryLevel);
+        break;
+    case libmyo_event_emg:
+        onEmgData(myo, time, data.emg);
+        break;
+    case libmyo_event_warmup_completed:
+        onWarmupCompleted(myo, time, data.warmupResult);
+        break;
+    }
+}
+
+} // namespace myo
@@ -48,6 +48,15 @@ class TimerListener;
 
 class UdpSocket;
 
+
+// A datagram queued for UdpSocket::SendBatch(). A null endpoint sends
+// the datagram to the connected endpoint, as Send() would.
+struct UdpDatagram{
+    const char *data;
+    std::size_t size;
+    const IpEndpointName *endpoint;
+};
+
 class SocketReceiveMultiplexer{
     class Implementation;
     Implementation *impl_;
@@ -119,6 +128,11 @@ public:
 	void Send( const char *data, std::size_t size );
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, std::size_t size );
 
+	// Send a number of datagrams using as few system calls as the
+	// platform allows (sendmmsg where available, otherwise one
+	// send/sendto per datagram).
+	void SendBatch( const UdpDatagram *datagrams, std::size_t count );
+
 
 	// Bind a local endpoint to receive incoming data. Endpoint
 	// can be 'any' for the system to choose an endpoint
@@ -61,6 +61,12 @@
 #include "ip/TimerListener.h"
 
 
+#if defined(__linux__)
+// sendmmsg() is available since Linux 3.0 / glibc 2.14
+#define OSCPACK_HAVE_SENDMMSG
+#endif
+
+
 #if defined(__APPLE__) && !defined(_SOCKLEN_T)
 // pre system 10.3 didn't have socklen_t
 typedef ssize_t socklen_t;
@@ -214,6 +220,50 @@ public:
         sendto( socket_, data, size, 0, (sockaddr*)&sendToAddr_, sizeof(sendToAddr_) );
 	}
 
+	void SendBatch( const UdpDatagram *datagrams, std::size_t count )
+	{
+#ifdef OSCPACK_HAVE_SENDMMSG
+        const std::size_t MAX_BATCH_SIZE = 64;
+        struct mmsghdr messages[ MAX_BATCH_SIZE ];
+        struct iovec iovecs[ MAX_BATCH_SIZE ];
+        struct sockaddr_in addresses[ MAX_BATCH_SIZE ];
+
+        while( count > 0 ){
+            std::size_t batchSize = std::min( count, MAX_BATCH_SIZE );
+            std::memset( messages, 0, sizeof(messages[0]) * batchSize );
+
+            for( std::size_t i = 0; i < batchSize; ++i ){
+                iovecs[i].iov_base = const_cast<char*>( datagrams[i].data );
+                iovecs[i].iov_len = datagrams[i].size;
+                messages[i].msg_hdr.msg_iov = &iovecs[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+
+                if( datagrams[i].endpoint ){
+                    SockaddrFromIpEndpointName( addresses[i], *datagrams[i].endpoint );
+                    messages[i].msg_hdr.msg_name = &addresses[i];
+                    messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+                }else{
+                    assert( isConnected_ );
+                }
+            }
+
+            int sent = sendmmsg( socket_, messages, (unsigned int)batchSize, 0 );
+
+            // like Send(), errors are ignored: skip the datagram that failed
+            std::size_t consumed = (sent > 0) ? (std::size_t)sent : 1;
+            datagrams += consumed;
+            count -= consumed;
+        }
+#else
+        for( std::size_t i = 0; i < count; ++i ){
+            if( datagrams[i].endpoint )
+                SendTo( *datagrams[i].endpoint, datagrams[i].data, datagrams[i].size );
+            else
+                Send( datagrams[i].data, datagrams[i].size );
+        }
+#endif
+	}
+
 	void Bind( const IpEndpointName& localEndpoint )
 	{
 		struct sockaddr_in bindSockAddr;
@@ -289,6 +339,11 @@ void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data,
 	impl_->SendTo( remoteEndpoint, data, size );
 }
 
+void UdpSocket::SendBatch( const UdpDatagram *datagrams, std::size_t count )
+{
+	impl_->SendBatch( datagrams, count );
+}
+
 void UdpSocket::Bind( const IpEndpointName& localEndpoint )
 {
 	impl_->Bind( localEndpoint );
@@ -282,6 +282,17 @@ void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data,
 	impl_->SendTo( remoteEndpoint, data, size );
 }
 
+void UdpSocket::SendBatch( const UdpDatagram *datagrams, std::size_t count )
+{
+	// winsock has no batched send for UDP, so send one datagram at a time
+	for( std::size_t i = 0; i < count; ++i ){
+		if( datagrams[i].endpoint )
+			impl_->SendTo( *datagrams[i].endpoint, datagrams[i].data, datagrams[i].size );
+		else
+			impl_->Send( datagrams[i].data, datagrams[i].size );
+	}
+}
+
 void UdpSocket::Bind( const IpEndpointName& localEndpoint )
 {
 	impl_->Bind( localEndpoint );
@@ -0,0 +1,33 @@
+//
+//  NullLibmyo.cpp
+//  myoosc-loadgen
+//
+//  The Myo SDK only ships for macOS and Windows. On other platforms the
+//  load generator links against these do-nothing versions of the few
+//  libmyo functions that DataSender references instead. They are never
+//  reached with synthetic devices.
+//
+
+#if !defined(__APPLE__) && !defined(_WIN32)
+
+#include <myo/libmyo.h>
+
+extern "C" {
+
+const char* libmyo_error_cstring(libmyo_error_details_t) {
+  return "";
+}
+
+libmyo_result_t libmyo_error_kind(libmyo_error_details_t) {
+  return libmyo_success;
+}
+
+void libmyo_free_error_details(libmyo_error_details_t) {}
+
+libmyo_result_t libmyo_set_stream_emg(libmyo_myo_t, libmyo_stream_emg_t, libmyo_error_details_t*) {
+  return libmyo_success;
+}
+
+}
+
+#endif
@@ -0,0 +1,155 @@
+//
+//  main.cpp
+//  myoosc-loadgen
+//
+//  Drives DataSender with synthetic events for a number of virtual Myo
+//  armbands and reports the sustained event rate and CPU usage. Doesn't
+//  need a Myo, Myo Connect or the Myo SDK libraries, so it also runs
+//  headless on Linux:
+//
+//    c++ -std=gnu++17 -O2 -pthread -o myoosc-loadgen
+//      -Ilibs -Ilibs/oscpack -Ilibs/myo.framework/Headers -Isrc
+//      $(ls src/*.cpp | grep -v main.cpp) loadgen/*.cpp
+//      libs/oscpack/osc/*.cpp libs/oscpack/ip/IpEndpointName.cpp
+//      libs/oscpack/ip/posix/*.cpp
+//
+//  (all on one line)
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DataSender.h"
+#include "DeviceManager.h"
+#include "EventLog.h"
+#include "Logger.h"
+#include "Settings.h"
+#include "SyntheticSource.h"
+#include "Trace.h"
+
+static const char usageText[] =
+"USAGE: myoosc-loadgen [--devices=<n>] [--seconds=<s>] [--fast] [MyoOsc2 options]\n"
+"   Sends the output of <n> virtual Myo armbands (default 8) for <s> seconds\n"
+"   (default 10), in real time or, with --fast, as fast as the sender keeps up.\n"
+"   With --replay=<file>, sends the events of a captured log instead.\n"
+"   --trace=<file> writes the timeline of the run; --capture isn't supported.\n";
+
+// Events kept per thread for --trace, as in MyoOsc2.
+static const std::size_t traceEventsPerThread = 65536;
+
+// Takes the option off the command line if it is there.
+static bool takeOption(std::vector<char*>& args, const std::string& name, std::string& value) {
+  for (auto it = args.begin() + 1; it != args.end(); ++it) {
+    std::string arg = *it;
+    if (arg == name || arg.compare(0, name.size() + 1, name + "=") == 0) {
+      value = arg.size() > name.size() ? arg.substr(name.size() + 1) : "";
+      args.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char * argv[]) {
+  std::vector<char*> args(argv, argv + argc);
+  std::size_t deviceCount = 8;
+  double seconds = 10;
+  std::string value;
+  if (takeOption(args, "--devices", value)) {
+    deviceCount = std::strtoul(value.c_str(), nullptr, 10);
+  }
+  if (takeOption(args, "--seconds", value)) {
+    seconds = std::strtod(value.c_str(), nullptr);
+  }
+  bool fast = takeOption(args, "--fast", value);
+  if (deviceCount < 1 || seconds <= 0) {
+    std::cerr << usageText;
+    return 1;
+  }
+
+  Settings settings;
+  if (!settings.parseArgs(static_cast<int>(args.size()), args.data())) {
+    std::cerr << '\n' << usageText;
+    return 1;
+  }
+  // the synthetic events don't come from libmyo, so there is nothing to capture
+  if (!settings.captureFile.empty()) {
+    std::cerr << "--capture isn't supported by the load generator\n\n" << usageText;
+    return 1;
+  }
+  if (!settings.traceFile.empty()) {
+    Trace::enable(traceEventsPerThread);
+    Trace::nameThread("loadgen");
+  }
+
+  Logger logger(settings);
+  std::uint64_t events = 0;
+  std::clock_t cpuStart;
+  std::chrono::steady_clock::time_point wallStart;
+  {
+    DataPaths dataPaths(settings);
+    DeviceManager devices(dataPaths);
+    DataSender sender(devices, settings, dataPaths, logger);
+    SyntheticSource source(deviceCount);
+    std::unique_ptr<EventReplay> replay;
+    if (!settings.replayFile.empty()) {
+      replay.reset(new EventReplay(settings.replayFile));
+      deviceCount = replay->deviceCount();
+    }
+
+    auto duration = static_cast<std::uint64_t>(seconds * 1e6);
+    const std::uint64_t step = 1000;
+    cpuStart = std::clock();
+    wallStart = std::chrono::steady_clock::now();
+    for (std::uint64_t time = 0; time < duration; time += step) {
+      // each step once the sender thread has caught up with the last, so
+      // that the queue doesn't overflow
+      if (fast) {
+        while (sender.queueOccupancy() > 0) {
+          std::this_thread::yield();
+        }
+      }
+      if (replay) {
+        if (replay->done()) {
+          break;
+        }
+        events += replay->run(sender, time);
+      } else {
+        events += source.run(sender, time);
+      }
+      sender.update();
+      if (!fast) {
+        std::this_thread::sleep_until(wallStart + std::chrono::microseconds(time + step));
+      }
+    }
+    // only what the sender got to send counts
+    events -= sender.queueOverflows();
+  }
+  // after the sender has sent what was queued and its threads have ended;
+  // process CPU time, so it includes the sender thread
+  auto wallEnd = std::chrono::steady_clock::now();
+  double cpu = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+  double wall = std::chrono::duration<double>(wallEnd - wallStart).count();
+
+  std::cout << std::dec << deviceCount << " devices, " << events << " events in " << wall << " s\n"
+            << "  " << events / wall << " events/s\n"
+            << "  CPU " << cpu << " s (" << 100 * cpu / wall << "% of one core), "
+            << 1e6 * cpu / events << " us per event\n";
+
+  if (!settings.traceFile.empty()) {
+    try {
+      auto traceEvents = Trace::writeChromeJson(settings.traceFile);
+      std::cout << "Wrote " << traceEvents << " trace events to " << settings.traceFile << "\n";
+    } catch (const std::runtime_error& e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,17 @@
+//
+//  ChangeFilter.cpp
+//  MyoOsc2
+//
+
+#include "ChangeFilter.h"
+
+ChangeFilter::ChangeFilter(const Settings& settings)
+: _deadbands(settings.deadbands)
+, _maxSilence(static_cast<std::uint64_t>(settings.maxSilence * 1e6))
+, _enabled(false)
+, _checked(0)
+, _suppressed(0) {
+  for (const auto& deadband : _deadbands) {
+    _enabled = _enabled || deadband.threshold > 0;
+  }
+}
@@ -0,0 +1,84 @@
+//
+//  ChangeFilter.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "Common.h"
+#include "Settings.h"
+
+// The last sample sent for one stream of one device.
+struct SentSample {
+  SentSample()
+  : valid(false)
+  , timestamp(0) {}
+
+  bool valid;
+  std::uint64_t timestamp;
+  std::array<float, emgLength> values;
+};
+
+using SentSamples = std::array<SentSample, numStreamClasses>;
+
+// Suppresses samples whose values all stay within the deadband of their
+// stream class around the last sample sent, until the stream has been
+// silent for longer than the refresh interval.
+class ChangeFilter {
+public:
+  explicit ChangeFilter(const Settings& settings);
+
+  bool enabled() const { return _enabled; }
+
+  // Whether the sample should be sent. If so, it becomes the last sample
+  // sent. Timestamps are the libmyo event timestamps in microseconds.
+  template<typename T>
+  bool passes(StreamClass streamClass, const T* values, std::size_t count,
+              std::uint64_t timestamp, SentSample& last);
+
+  std::uint64_t checked() const { return _checked; }
+  std::uint64_t suppressed() const { return _suppressed; }
+
+  // Fraction of the checked samples that were suppressed.
+  double suppressionRatio() const {
+    return _checked ? static_cast<double>(_suppressed) / _checked : 0;
+  }
+
+private:
+  std::array<Deadband, numStreamClasses> _deadbands;
+  std::uint64_t _maxSilence;
+  bool _enabled;
+  std::uint64_t _checked;
+  std::uint64_t _suppressed;
+};
+
+template<typename T>
+bool ChangeFilter::passes(StreamClass streamClass, const T* values, std::size_t count,
+                          std::uint64_t timestamp, SentSample& last) {
+  const auto& deadband = _deadbands[static_cast<std::size_t>(streamClass)];
+  if (deadband.threshold <= 0) {
+    return true;
+  }
+  _checked++;
+  bool changed = !last.valid || timestamp - last.timestamp >= _maxSilence;
+  for (std::size_t i = 0; i < count && !changed; i++) {
+    auto threshold = deadband.relative
+      ? deadband.threshold * std::fabs(last.values[i])
+      : deadband.threshold;
+    changed = std::fabs(static_cast<float>(values[i]) - last.values[i]) > threshold;
+  }
+  if (!changed) {
+    _suppressed++;
+    return false;
+  }
+  last.valid = true;
+  last.timestamp = timestamp;
+  for (std::size_t i = 0; i < count; i++) {
+    last.values[i] = static_cast<float>(values[i]);
+  }
+  return true;
+}
@@ -0,0 +1,44 @@
+//
+//  CommandQueue.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Commands posted from any thread, to be run on the thread that owns the
+// queue (the Myo hub thread) between calls to Hub::run().
+class CommandQueue {
+public:
+  using Command = std::function<void()>;
+
+  void post(Command command) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pending.push_back(std::move(command));
+  }
+
+  // Runs all commands posted so far, in order.
+  void runPending() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_pending.empty()) {
+        return;
+      }
+      _running.swap(_pending);
+    }
+    for (auto& command : _running) {
+      command();
+    }
+    _running.clear();
+  }
+
+private:
+  std::mutex _mutex;
+  std::vector<Command> _pending;
+  // only touched by the owning thread
+  std::vector<Command> _running;
+};
@@ -18,6 +18,13 @@ const MyoId unknownMyoId = -1;
 
 const std::size_t emgLength = 8;
 
+// EMG frames per second.
+const std::size_t emgRate = 200;
+
+// Equal frequency bands up to the Nyquist frequency of the EMG, for the
+// band power of EmgSpectrum.
+const std::size_t numEmgBands = 4;
+
 const std::size_t numPoses = libmyo_num_poses;
 
 const std::size_t numArms = 2;
@@ -50,7 +57,7 @@ std::ostream&
 operator<<(std::ostream& os,
            const myo::Quaternion<T>& value) {
   return os << "(" << value.x() << ", "
-  << value.y() << ", " << value.z()
+  << value.y() << ", " << value.z() << ", "
   << value.w() << ")";
 }
 
@@ -0,0 +1,84 @@
+//
+//  ControlServer.cpp
+//  MyoOsc2
+//
+
+#include "ControlServer.h"
+#include <cstring>
+#include "osc/OscReceivedElements.h"
+#include "Trace.h"
+
+static const char subscribeAddress[] = "/myoosc/subscribe";
+static const char unsubscribeAddress[] = "/myoosc/unsubscribe";
+
+static std::string describe(const std::string& pattern, const IpEndpointName& endpoint) {
+  char address[IpEndpointName::ADDRESS_AND_PORT_STRING_LENGTH];
+  endpoint.AddressAndPortAsString(address);
+  return pattern + " for " + address;
+}
+
+ControlServer::ControlServer(int port, Subscriptions& subscriptions, Logger& logger)
+: _subscriptions(subscriptions)
+, _logger(logger)
+, _socket(IpEndpointName(IpEndpointName::ANY_ADDRESS, port), this) {
+  _thread = std::thread([this] {
+    Trace::nameThread("control");
+    _socket.Run();
+  });
+}
+
+ControlServer::~ControlServer() {
+  _socket.AsynchronousBreak();
+  _thread.join();
+}
+
+void ControlServer::ProcessPacket(const char* data, int size, const IpEndpointName& remoteEndpoint) {
+  // a bad request must not take the thread down
+  try {
+    osc::OscPacketListener::ProcessPacket(data, size, remoteEndpoint);
+  } catch (const osc::Exception& e) {
+    _logger.log() << "Invalid control message: " << e.what() << std::endl;
+  }
+}
+
+void ControlServer::ProcessMessage(const osc::ReceivedMessage& message, const IpEndpointName& remoteEndpoint) {
+  bool subscribe = std::strcmp(message.AddressPattern(), subscribeAddress) == 0;
+  if (!subscribe && std::strcmp(message.AddressPattern(), unsubscribeAddress) != 0) {
+    _logger.verbose() << "Unknown control message " << message.AddressPattern() << std::endl;
+    return;
+  }
+
+  auto args = message.ArgumentsBegin();
+  if (args == message.ArgumentsEnd()) {
+    throw osc::MissingArgumentException();
+  }
+  std::string pattern = (args++)->AsString();
+  IpEndpointName endpoint = remoteEndpoint;
+  if (args != message.ArgumentsEnd()) {
+    const char* host = (args++)->AsString();
+    if (args == message.ArgumentsEnd()) {
+      throw osc::MissingArgumentException();
+    }
+    auto port = static_cast<int>((args++)->AsInt32());
+    endpoint = *host ? IpEndpointName(host, port) : IpEndpointName(remoteEndpoint.address, port);
+  }
+  if (pattern.empty() || pattern[0] != '/') {
+    _logger.log() << "Invalid subscription pattern " << pattern << std::endl;
+    return;
+  }
+
+  if (subscribe) {
+    switch (_subscriptions.subscribe(pattern, endpoint, Subscriptions::Clock::now())) {
+      case Subscriptions::Result::added:
+        _logger.log() << "Subscribed " << describe(pattern, endpoint) << std::endl;
+        break;
+      case Subscriptions::Result::full:
+        _logger.log() << "Too many subscribers, refused " << describe(pattern, endpoint) << std::endl;
+        break;
+      default:
+        break;
+    }
+  } else if (_subscriptions.unsubscribe(pattern, endpoint) == Subscriptions::Result::removed) {
+    _logger.log() << "Unsubscribed " << describe(pattern, endpoint) << std::endl;
+  }
+}
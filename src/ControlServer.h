@@ -0,0 +1,42 @@
+//
+//  ControlServer.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <string>
+#include <thread>
+#include "ip/UdpSocket.h"
+#include "osc/OscPacketListener.h"
+#include "Logger.h"
+#include "Subscriptions.h"
+
+// Listens for subscription requests on a UDP port, on a thread of its own:
+//
+//   /myoosc/subscribe <pattern> [<host> <port>]
+//   /myoosc/unsubscribe <pattern> [<host> <port>]
+//
+// Without a host and port, the messages go to the address and port that
+// the request came from; with an empty host, to that address. Subscribing
+// again renews the lease.
+class ControlServer : public osc::OscPacketListener {
+public:
+  // Throws std::runtime_error when the port can't be bound.
+  ControlServer(int port, Subscriptions& subscriptions, Logger& logger);
+  ~ControlServer();
+
+  ControlServer(const ControlServer&) = delete;
+  ControlServer& operator=(const ControlServer&) = delete;
+
+  void ProcessPacket(const char* data, int size, const IpEndpointName& remoteEndpoint) override;
+
+protected:
+  void ProcessMessage(const osc::ReceivedMessage& message, const IpEndpointName& remoteEndpoint) override;
+
+private:
+  Subscriptions& _subscriptions;
+  Logger& _logger;
+  UdpListeningReceiveSocket _socket;
+  std::thread _thread;
+};
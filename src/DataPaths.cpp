@@ -5,17 +5,23 @@
 
 #include "DataPaths.h"
 
-static DeviceDataPaths unknownPaths("/__/");
-
-DataPaths::DataPaths()
-: _arms {
-  DeviceDataPaths::byArm(myo::Arm::armLeft),
-  DeviceDataPaths::byArm(myo::Arm::armRight)
-} {}
+static DeviceDataPaths unknownPaths("/__/", Settings());
+
+DataPaths::DataPaths(const Settings& settings)
+: _settings(settings) {
+  _arms[myo::Arm::armLeft] = DeviceDataPaths::byArm(myo::Arm::armLeft, settings);
+  _arms[myo::Arm::armRight] = DeviceDataPaths::byArm(myo::Arm::armRight, settings);
+  static const std::array<std::string, numLatencyClasses> latencyNames = {
+    "orientation", "accel", "gyro", "emg", "rssi", "other"
+  };
+  for (std::size_t i = 0; i < numLatencyClasses; i++) {
+    _latency[i] = MessageTemplate("/myoosc/stats/latency/" + latencyNames[i], "hffff");
+  }
+}
 
 const DeviceDataPaths& DataPaths::operator[](MyoId id) {
   while (id >= _devices.size()) {
-    _devices.push_back(DeviceDataPaths::byDeviceId(id));
+    _devices.push_back(DeviceDataPaths::byDeviceId(_devices.size(), _settings));
   }
   return _devices[id];
 }
@@ -27,65 +33,82 @@ const DeviceDataPaths& DataPaths::operator[](myo::Arm arm) const {
   return _arms[static_cast<std::size_t>(arm)];
 }
 
-DeviceDataPaths DeviceDataPaths::byDeviceId(MyoId id) {
+DeviceDataPaths DeviceDataPaths::byDeviceId(MyoId id, const Settings& settings) {
   std::string base = "/myo/" + std::to_string(static_cast<int>(id)) + "/";
-  return DeviceDataPaths(base);
+  return DeviceDataPaths(base, settings);
 }
 
-DeviceDataPaths DeviceDataPaths::byArm(myo::Arm arm) {
+DeviceDataPaths DeviceDataPaths::byArm(myo::Arm arm, const Settings& settings) {
   switch (arm) {
     case myo::Arm::armLeft:
-      return DeviceDataPaths("/arm/left/");
+      return DeviceDataPaths("/arm/left/", settings);
     case myo::Arm::armRight:
-      return DeviceDataPaths("/arm/right/");
+      return DeviceDataPaths("/arm/right/", settings);
     default:
       return unknownPaths;
   }
 }
 
-DeviceDataPaths::DeviceDataPaths(std::string base) {
-  paired = base + "paired";
-  connected = base + "connected";
-  synced = base + "synced";
-  arm = base + "arm";
-  deviceDirection = base + "deviceDirection";
-  armRotation = base + "armRotation";
-  warmupState = base + "warmupState";
-  locked = base + "locked";
+// Booleans are sent as a T or F type tag without an argument, so their
+// templates carry a T that is flipped to F for false values.
+static const std::string boolTag = "T";
+static const std::string intTag = "i";
+static const std::string floatTag = "f";
+
+DeviceDataPaths::DeviceDataPaths(std::string base, const Settings& settings) {
+  paired = MessageTemplate(base + "paired", boolTag);
+  connected = MessageTemplate(base + "connected", boolTag);
+  synced = MessageTemplate(base + "synced", boolTag);
+  arm = MessageTemplate(base + "arm", intTag);
+  deviceDirection = MessageTemplate(base + "deviceDirection", intTag);
+  armRotation = MessageTemplate(base + "armRotation", floatTag);
+  warmupState = MessageTemplate(base + "warmupState", intTag);
+  locked = MessageTemplate(base + "locked", boolTag);
 
   // poses
-  for (auto i = 0; i < numPoses; i++) {
-    poses[i] = base + "pose/" + myo::Pose(static_cast<myo::Pose::Type>(i)).toString();
+  for (std::size_t i = 0; i < numPoses; i++) {
+    poses[i] = MessageTemplate(base + "pose/" + myo::Pose(static_cast<myo::Pose::Type>(i)).toString(), boolTag);
   }
 
-  // orientQuat
-  orientQuat[0] = base + "orientQuat/x";
-  orientQuat[1] = base + "orientQuat/y";
-  orientQuat[2] = base + "orientQuat/z";
-  orientQuat[3] = base + "orientQuat/w";
-
-  // orientVec
-  orientVec[0] = base + "orientVec/x";
-  orientVec[1] = base + "orientVec/y";
-  orientVec[2] = base + "orientVec/z";
-
-  // accel
-  accel[0] = base + "accel/x";
-  accel[1] = base + "accel/y";
-  accel[2] = base + "accel/z";
-
-  // gyro
-  gyro[0] = base + "gyro/x";
-  gyro[1] = base + "gyro/y";
-  gyro[2] = base + "gyro/z";
+  orientQuat = VectorDataPaths<4>(base + "orientQuat", {"x", "y", "z", "w"}, 'f');
+  orientVec = VectorDataPaths<3>(base + "orientVec", {"x", "y", "z"}, 'f');
+  accel = VectorDataPaths<3>(base + "accel", {"x", "y", "z"}, 'f');
+  gyro = VectorDataPaths<3>(base + "gyro", {"x", "y", "z"}, 'f');
 
-  rssi = base + "rssi";
-  battery = base + "battery";
+  rssi = MessageTemplate(base + "rssi", intTag);
+  battery = MessageTemplate(base + "battery", intTag);
 
   // emg
-  for (auto i = 0; i < emgLength; i++) {
-    emg[i] = base + "emg/" + std::to_string(i);
+  std::array<std::string, emgLength> channels;
+  for (std::size_t i = 0; i < emgLength; i++) {
+    channels[i] = std::to_string(i);
+  }
+  emg = VectorDataPaths<emgLength>(base + "emg", channels, 'i');
+  if (settings.emgBlob) {
+    emgBlob = MessageTemplate(base + "emg", "b", emgLength);
+  }
+  if (settings.emgBatchFrames > 0) {
+    // base timestamp, sample period, samples
+    emgBatch = MessageTemplate(base + "emg/batch", "hib", settings.emgBatchFrames * emgLength);
+  }
+  if (settings.emgEnvelopeWindow > 0) {
+    emgRms = VectorDataPaths<emgLength>(base + "emg/rms", channels, 'f');
+    emgMav = VectorDataPaths<emgLength>(base + "emg/mav", channels, 'f');
+  }
+  if (settings.emgSpectrumWindow > 0) {
+    // by channel, then band
+    std::array<std::string, emgLength * numEmgBands> bands;
+    for (std::size_t i = 0; i < bands.size(); i++) {
+      bands[i] = channels[i / numEmgBands] + "/" + std::to_string(i % numEmgBands);
+    }
+    emgBands = VectorDataPaths<emgLength * numEmgBands>(base + "emg/bands", bands, 'f');
+    emgMeanFreq = VectorDataPaths<emgLength>(base + "emg/meanFreq", channels, 'f');
+    emgMedianFreq = VectorDataPaths<emgLength>(base + "emg/medianFreq", channels, 'f');
+  }
+  if (!settings.gestureModelFile.empty()) {
+    // class, confidence
+    gesture = MessageTemplate(base + "gesture", "if");
   }
 
-  warmupResult = base + "warmupResult";
+  warmupResult = MessageTemplate(base + "warmupResult", intTag);
 }
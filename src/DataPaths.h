@@ -6,43 +6,90 @@
 #pragma once
 
 #include <array>
+#include <deque>
 #include <string>
-#include <vector>
 #include "Common.h"
+#include "MessageTemplate.h"
+#include "Settings.h"
+
+// Addresses for a multi-component value: the single address used by the
+// vector path schema, plus one address per component for the legacy schema.
+template<std::size_t N>
+class VectorDataPaths {
+public:
+  VectorDataPaths() {}
+  VectorDataPaths(const std::string& path,
+                  const std::array<std::string, N>& names,
+                  char typeTag)
+  : vector(path, std::string(N, typeTag)) {
+    for (std::size_t i = 0; i < N; i++) {
+      components[i] = MessageTemplate(path + "/" + names[i], std::string(1, typeTag));
+    }
+  }
+
+  const MessageTemplate& operator[](std::size_t i) const {
+    return components[i];
+  }
+
+  MessageTemplate vector;
+  std::array<MessageTemplate, N> components;
+};
 
 class DeviceDataPaths {
 public:
-  static DeviceDataPaths byDeviceId(MyoId id);
-  static DeviceDataPaths byArm(myo::Arm arm);
+  static DeviceDataPaths byDeviceId(MyoId id, const Settings& settings);
+  static DeviceDataPaths byArm(myo::Arm arm, const Settings& settings);
 
   DeviceDataPaths() {}
-  explicit DeviceDataPaths(std::string base);
-
-  std::string paired;
-  std::string connected;
-  std::string synced;
-  std::string arm;
-  std::string deviceDirection;
-  std::string armRotation;
-  std::string warmupState;
-  std::string locked;
-  std::array<std::string, numPoses> poses;
-  std::array<std::string, 4> orientQuat;
-  std::array<std::string, 3> orientVec;
-  std::array<std::string, 3> accel;
-  std::array<std::string, 3> gyro;
-  std::string rssi;
-  std::string battery;
-  std::array<std::string, emgLength> emg;
-  std::string warmupResult;
+  DeviceDataPaths(std::string base, const Settings& settings);
+
+  MessageTemplate paired;
+  MessageTemplate connected;
+  MessageTemplate synced;
+  MessageTemplate arm;
+  MessageTemplate deviceDirection;
+  MessageTemplate armRotation;
+  MessageTemplate warmupState;
+  MessageTemplate locked;
+  std::array<MessageTemplate, numPoses> poses;
+  VectorDataPaths<4> orientQuat;
+  VectorDataPaths<3> orientVec;
+  VectorDataPaths<3> accel;
+  VectorDataPaths<3> gyro;
+  MessageTemplate rssi;
+  MessageTemplate battery;
+  VectorDataPaths<emgLength> emg;
+  // only set up with --emg-blob
+  MessageTemplate emgBlob;
+  // only set up with --emg-batch
+  MessageTemplate emgBatch;
+  // only set up with --emg-rms
+  VectorDataPaths<emgLength> emgRms;
+  VectorDataPaths<emgLength> emgMav;
+  // only set up with --emg-spectrum
+  VectorDataPaths<emgLength * numEmgBands> emgBands;
+  VectorDataPaths<emgLength> emgMeanFreq;
+  VectorDataPaths<emgLength> emgMedianFreq;
+  // only set up with --gesture-model
+  MessageTemplate gesture;
+  MessageTemplate warmupResult;
 };
 
 class DataPaths {
 public:
-  DataPaths();
+  explicit DataPaths(const Settings& settings);
+  // References stay valid as more devices are added, so they can be handed
+  // to other threads.
   const DeviceDataPaths& operator[](MyoId id);
   const DeviceDataPaths& operator[](myo::Arm arm) const;
+  // /myoosc/stats/latency/<stream>, indexed by stream class, then other
+  // events
+  const MessageTemplate& latency(std::size_t latencyClass) const {
+    return _latency[latencyClass];
+  }
 private:
-  std::vector<DeviceDataPaths> _devices;
+  const Settings& _settings;
+  std::deque<DeviceDataPaths> _devices;
   std::array<DeviceDataPaths, numArms> _arms;
+  std::array<MessageTemplate, numLatencyClasses> _latency;
 };
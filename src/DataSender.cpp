@@ -4,118 +4,839 @@
 //
 
 #include "DataSender.h"
+#include <algorithm>
+#include <chrono>
 #include <iomanip>
+#include <sstream>
+#include "Euler.h"
+#include "osc/OscTypes.h"
+#include "Trace.h"
 
-static myo::Vector3<float>
-quaternionToVector(const myo::Quaternion<float>& quat) {
-  // Calculate Euler angles (roll, pitch, and yaw) from the unit quaternion.
-  float yaw = atan2(2.0f * (quat.w() * quat.z() + quat.x() * quat.y()),
-                    1.0f - 2.0f * (quat.y() * quat.y() + quat.z() * quat.z()));
-  float pitch = asin(2.0f * (quat.w() * quat.y() - quat.z() * quat.x()));
-  float roll = atan2(2.0f * (quat.w() * quat.x() + quat.y() * quat.z()),
-                     1.0f - 2.0f * (quat.x() * quat.x() + quat.y() * quat.y()));
-  return myo::Vector3<float>(yaw, pitch, roll);
+// Formats a value with one decimal, without changing the flags of the log
+// stream.
+static std::string oneDecimal(double value) {
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(1) << value;
+  return text.str();
 }
 
 DataSender::DataSender(DeviceManager& devices,
                        const Settings& settings,
                        const DataPaths& dataPaths,
-                       Logger& logger)
+                       Logger& logger,
+                       const Subscriptions* subscriptions,
+                       const GestureModel* gestures)
 : _devices(devices)
 , _settings(settings)
 , _dataPaths(dataPaths)
 , _logger(logger)
-, _socket(std::make_unique<UdpTransmitSocket>(IpEndpointName(settings.hostname.c_str(), settings.port))) {}
+, _packet(_buffer, OUTPUT_BUFFER_SIZE, MAX_PACKET_SIZE)
+, _socket(std::make_unique<UdpSocket>())
+, _allDestinations(0)
+, _filtered(false)
+, _subscriptions(subscriptions)
+, _subscriptionVersion(0)
+, _datagramsSent(0)
+, _bytesSent(0)
+, _rateLimiter(settings)
+, _gestures(gestures)
+, _changeFilter(settings)
+, _running(false)
+, _sleeping(false) {
+  for (const auto& dest : _settings.destinations) {
+    _allDestinations |= PacketBuilder::DestinationMask(1) << _endpoints.size();
+    _endpoints.push_back(IpEndpointName(dest.hostname.c_str(), dest.port));
+    _filtered = _filtered || !dest.prefix.empty();
+  }
+  if (_subscriptions) {
+    _endpoints.reserve(Settings::maxDestinations);
+    updateSubscribers();
+  }
+  _datagrams.reserve(PacketBuilder::maxPackets * _endpoints.capacity());
+  _unsent.reserve(eventQueueSize);
+  if (_settings.emgSpectrumWindow > 0) {
+    _spectrum = std::make_unique<EmgSpectrum>(
+      _settings.emgSpectrumWindow, _settings.emgSpectrumEvery, [this] {
+        std::lock_guard<std::mutex> lock(_wakeMutex);
+        _wake.notify_one();
+      });
+  }
+  if (_settings.senderThread) {
+    _running = true;
+    _thread = std::thread(&DataSender::run, this);
+  }
+}
+
+DataSender::~DataSender() {
+  // the results of the frames queued so far are sent below
+  if (_spectrum) {
+    _spectrum->stop();
+  }
+  if (_thread.joinable()) {
+    _running = false;
+    {
+      std::lock_guard<std::mutex> lock(_wakeMutex);
+      _wake.notify_one();
+    }
+    _thread.join();
+  } else if (_spectrum) {
+    sendSpectra();
+    flush();
+  }
+  // the verbose log refers to the paths of the devices
+  _logger.flush();
+  logStats();
+  logLatency();
+}
+
+void DataSender::logStats() {
+  if (_thread.joinable() || queueOverflows() > 0) {
+    _logger.log() << "Sender queue: " << std::dec << queueOccupancy() << " queued, "
+                  << queueOverflows() << " dropped" << std::endl;
+  }
+  if (_changeFilter.enabled()) {
+    _logger.log() << "Deadband suppressed " << std::dec << _changeFilter.suppressed()
+                  << " of " << _changeFilter.checked() << " samples ("
+                  << oneDecimal(_changeFilter.suppressionRatio() * 100) << "%)" << std::endl;
+  }
+  if (_spectrum && (_spectrum->framesDropped() > 0 || _spectrum->resultsDropped() > 0)) {
+    _logger.log() << "EMG spectrum dropped " << std::dec << _spectrum->framesDropped()
+                  << " frames, " << _spectrum->resultsDropped() << " results" << std::endl;
+  }
+}
+
+void DataSender::publishLatency() {
+  EventRecord record = {};
+  record.type = EventType::latencyStats;
+  dispatch(record);
+}
+
+void DataSender::sendLatencyStats() {
+  beginEvent();
+  for (std::size_t c = 0; c < numLatencyClasses; c++) {
+    auto& histogram = _latency[c];
+    if (histogram.count() == 0) {
+      continue;
+    }
+    if (char* message = beginMessage(_dataPaths.latency(c))) {
+      char* slot = message + _dataPaths.latency(c).argumentOffset();
+      slot = writeOscArgument(slot, static_cast<std::int64_t>(histogram.count()));
+      slot = writeOscArgument(slot, histogram.percentile(50) / 1e3f);
+      slot = writeOscArgument(slot, histogram.percentile(90) / 1e3f);
+      slot = writeOscArgument(slot, histogram.percentile(99) / 1e3f);
+      writeOscArgument(slot, histogram.max() / 1e3f);
+    }
+    _latencyTotal[c].add(histogram);
+    histogram.reset();
+  }
+  endEvent();
+}
+
+void DataSender::logLatency() {
+  for (std::size_t c = 0; c < numLatencyClasses; c++) {
+    auto& total = _latencyTotal[c];
+    total.add(_latency[c]);
+    _latency[c].reset();
+    if (total.count() == 0) {
+      continue;
+    }
+    const auto& address = _dataPaths.latency(c).address();
+    _logger.log() << "Latency " << address.substr(address.rfind('/') + 1) << ": "
+                  << std::dec << total.count() << " events, p50 "
+                  << oneDecimal(total.percentile(50) / 1e3) << " us, p90 "
+                  << oneDecimal(total.percentile(90) / 1e3) << " us, p99 "
+                  << oneDecimal(total.percentile(99) / 1e3) << " us, max "
+                  << oneDecimal(total.max() / 1e3) << " us" << std::endl;
+  }
+}
+
+// Steady clock time in nanoseconds.
+static std::uint64_t steadyNanoseconds() {
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+EventRecord DataSender::makeRecord(const DeviceState& state, EventType type, uint64_t timestamp) const {
+  EventRecord record;
+  record.type = type;
+  record.arm = static_cast<std::int8_t>(state.arm);
+  record.suppressed = false;
+  record.deviceId = static_cast<std::uint32_t>(state.deviceId);
+  record.timestamp = timestamp;
+  record.received = steadyNanoseconds();
+  record.paths = &state.paths;
+  return record;
+}
+
+void DataSender::update() {
+  if (!_thread.joinable()) {
+    emitDueSamples();
+    if (_spectrum) {
+      sendSpectra();
+    }
+    flush();
+  }
+}
+
+void DataSender::dispatch(const EventRecord& record) {
+  TraceSpan span("deliver", record.deviceId, record.type);
+  if (!_thread.joinable()) {
+    accept(record);
+    emitDueSamples();
+    if (_spectrum) {
+      sendSpectra();
+    }
+    flush();
+    return;
+  }
+  if (!_queue.push(record)) {
+    return;
+  }
+  if (Trace::enabled()) {
+    Trace::counter("sender queue", static_cast<std::int64_t>(_queue.size()));
+  }
+  // pairs with the fence in run(): either the sender thread sees the new
+  // record before going to sleep, or we see that it is sleeping
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_sleeping.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(_wakeMutex);
+    _wake.notify_one();
+  }
+}
+
+void DataSender::run() {
+  Trace::nameThread("sender");
+  EventRecord record;
+  while (_running) {
+    if (_queue.pop(record)) {
+      accept(record);
+      if (_rateLimiter.enabled()) {
+        emitDueSamples();
+      }
+      if (_spectrum) {
+        sendSpectra();
+      }
+      continue;
+    }
+    emitDueSamples();
+    if (_spectrum) {
+      sendSpectra();
+    }
+    // send everything encoded since the queue was last empty in one batch
+    flush();
+    std::unique_lock<std::mutex> lock(_wakeMutex);
+    _sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_queue.empty() && !(_spectrum && _spectrum->hasResults()) && _running) {
+      auto timeout = RateLimiter::Clock::now() + std::chrono::milliseconds(100);
+      if (_rateLimiter.hasPending()) {
+        timeout = std::min(timeout, _rateLimiter.nextDue());
+      }
+      _wake.wait_until(lock, timeout);
+    }
+    _sleeping.store(false, std::memory_order_relaxed);
+  }
+  while (_queue.pop(record)) {
+    accept(record);
+  }
+  if (_spectrum) {
+    sendSpectra();
+  }
+  flush();
+}
 
-osc::OutboundPacketStream DataSender::beginMessage(const std::string& path) {
-  osc::OutboundPacketStream p(_buffer, OUTPUT_BUFFER_SIZE);
-  p << osc::BeginMessage(path.c_str());
-  return p;
+static std::uint8_t streamBit(StreamClass streamClass) {
+  return static_cast<std::uint8_t>(1 << static_cast<unsigned>(streamClass));
 }
 
-void DataSender::send(const osc::OutboundPacketStream& p) {
-  _socket->Send(p.Data(), p.Size());
+static const std::array<StreamClass, 3> imuStreams = {
+  StreamClass::orientation,
+  StreamClass::accel,
+  StreamClass::gyro,
+};
+
+// One of the streams of an IMU record, as a record of its own.
+static EventRecord imuPart(const EventRecord& record, StreamClass streamClass) {
+  EventRecord part = record;
+  const auto& imu = record.payload.imu;
+  switch (streamClass) {
+    case StreamClass::orientation:
+      part.type = EventType::orientation;
+      std::copy(imu.quat, imu.quat + 4, part.payload.quat);
+      break;
+    case StreamClass::accel:
+      part.type = EventType::accelerometer;
+      std::copy(imu.accel, imu.accel + 3, part.payload.vec);
+      break;
+    default:
+      part.type = EventType::gyroscope;
+      std::copy(imu.gyro, imu.gyro + 3, part.payload.vec);
+      break;
+  }
+  return part;
+}
+
+void DataSender::accept(const EventRecord& record) {
+  if (record.type == EventType::emg && (_settings.emgEnvelopeWindow > 0 || _gestures)) {
+    // the envelope and gestures are computed from every frame, including
+    // those that are held back or suppressed
+    if (_settings.emgEnvelopeWindow > 0) {
+      envelopeEmg(record);
+    }
+    if (_gestures) {
+      classifyEmg(record);
+    }
+    if (record.suppressed) {
+      return;
+    }
+  }
+  if (record.type == EventType::imu && _rateLimiter.enabled()
+      && std::any_of(imuStreams.begin(), imuStreams.end(),
+                     [this](StreamClass c) { return _rateLimiter.limited(c); })) {
+    // rate limited streams go out on their own schedules
+    for (auto streamClass : imuStreams) {
+      if (record.payload.imu.streams & streamBit(streamClass)) {
+        accept(imuPart(record, streamClass));
+      }
+    }
+    return;
+  }
+  if (!_rateLimiter.hold(record)) {
+    process(record);
+  }
 }
 
-void DataSender::sendMessage(const std::array<std::string, emgLength>& path,
+void DataSender::emitDueSamples() {
+  _rateLimiter.emitDue(RateLimiter::Clock::now(), [this](const EventRecord& record) {
+    process(record);
+  });
+}
+
+void DataSender::updateSubscribers() {
+  // a slot given up since may already belong to someone else
+  flush();
+  _subscriptionVersion = _subscriptions->copy(_subscribers);
+  _endpoints.resize(_settings.destinations.size());
+  for (const auto& subscriber : _subscribers) {
+    _endpoints.push_back(subscriber.endpoint);
+  }
+  _destinationCache.clear();
+}
+
+void DataSender::beginEvent() {
+  if (_subscriptions && _subscriptions->version() != _subscriptionVersion) {
+    updateSubscribers();
+  }
+  if (!_packet.hasSpaceForPacket()) {
+    flush();
+  }
+  if (_settings.bundle) {
+    _packet.beginBundle();
+  }
+}
+
+void DataSender::endEvent() {
+  _packet.endBundle();
+}
+
+void DataSender::flush() {
+  _packet.endBundle();
+  if (!_packet.empty()) {
+    // each packet was encoded once, and goes out to every destination
+    // that wants it
+    _datagrams.clear();
+    std::uint64_t bytes = 0;
+    for (std::size_t i = 0; i < _packet.packetCount(); i++) {
+      auto destinations = _packet.packetDestinations(i);
+      for (std::size_t d = 0; d < _endpoints.size(); d++) {
+        if (destinations & (PacketBuilder::DestinationMask(1) << d)) {
+          _datagrams.push_back({_packet.packetData(i), _packet.packetSize(i), &_endpoints[d]});
+          bytes += _packet.packetSize(i);
+        }
+      }
+    }
+    {
+      TraceSpan span("send");
+      _socket->SendBatch(_datagrams.data(), _datagrams.size());
+    }
+    _datagramsSent.fetch_add(_datagrams.size(), std::memory_order_relaxed);
+    _bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+    auto sent = steadyNanoseconds();
+    for (const auto& event : _unsent) {
+      _latency[event.latencyClass].record(sent - event.received);
+    }
+  }
+  _unsent.clear();
+  _packet.clear();
+}
+
+PacketBuilder::DestinationMask DataSender::destinationsFor(const MessageTemplate& message) {
+  if (!_filtered && !_subscriptions) {
+    return _allDestinations;
+  }
+  if (message.id() >= _destinationCache.size()) {
+    _destinationCache.resize(message.id() + 1, unknownDestinations);
+  }
+  auto& cached = _destinationCache[message.id()];
+  if (cached == unknownDestinations) {
+    cached = matchDestinations(message);
+  }
+  return static_cast<PacketBuilder::DestinationMask>(cached);
+}
+
+PacketBuilder::DestinationMask DataSender::matchDestinations(const MessageTemplate& message) const {
+  PacketBuilder::DestinationMask destinations = _filtered ? 0 : _allDestinations;
+  std::size_t fixed = _settings.destinations.size();
+  for (std::size_t d = 0; _filtered && d < fixed; d++) {
+    const auto& prefix = _settings.destinations[d].prefix;
+    if (message.address().compare(0, prefix.size(), prefix) == 0) {
+      destinations |= PacketBuilder::DestinationMask(1) << d;
+    }
+  }
+  for (std::size_t s = 0; s < _subscribers.size(); s++) {
+    const auto& patterns = _subscribers[s].patterns;
+    if (std::any_of(patterns.begin(), patterns.end(), [&](const std::string& pattern) {
+          return matchesAddressPattern(pattern, message.address());
+        })) {
+      destinations |= PacketBuilder::DestinationMask(1) << (fixed + s);
+    }
+  }
+  return destinations;
+}
+
+char* DataSender::beginMessage(const MessageTemplate& message) {
+  auto destinations = destinationsFor(message);
+  if (!destinations) {
+    return nullptr;
+  }
+  if (!_packet.hasSpaceFor(message, destinations)) {
+    auto bundling = _packet.isBundleInProgress();
+    flush();
+    if (bundling) {
+      _packet.beginBundle();
+    }
+  }
+  return _packet.addMessage(message, destinations);
+}
+
+void DataSender::send(const MessageTemplate& path, bool val) {
+  char* message = beginMessage(path);
+  if (message && !val) {
+    message[path.typeTagOffset()] = osc::FALSE_TYPE_TAG;
+  }
+}
+
+void DataSender::send(const MessageTemplate& path, std::int32_t val) {
+  if (char* message = beginMessage(path)) {
+    writeOscArgument(message + path.argumentOffset(), val);
+  }
+}
+
+void DataSender::send(const MessageTemplate& path, float val) {
+  if (char* message = beginMessage(path)) {
+    writeOscArgument(message + path.argumentOffset(), val);
+  }
+}
+
+void DataSender::sendMessage(const VectorDataPaths<emgLength>& path,
                              const int8_t* vals) {
-  for (auto i = 0; i < emgLength; i++) {
-    sendMessage(path[i], vals[i]);
+  if (_settings.schema == PathSchema::vectors) {
+    if (char* message = beginMessage(path.vector)) {
+      char* slot = message + path.vector.argumentOffset();
+      for (std::size_t i = 0; i < emgLength; i++) {
+        slot = writeOscArgument(slot, static_cast<std::int32_t>(vals[i]));
+      }
+    }
+  } else {
+    for (std::size_t i = 0; i < emgLength; i++) {
+      send(path[i], static_cast<std::int32_t>(vals[i]));
+    }
   }
+  _logger.verboseMessage(path, vals);
 }
 
-void DataSender::sendMessage(const std::array<std::string, 3>& path,
-                             myo::Vector3<float> vec) {
-  send(path[0], vec.x());
-  send(path[1], vec.y());
-  send(path[2], vec.z());
+template<std::size_t N>
+void DataSender::sendMessage(const VectorDataPaths<N>& path, const float* vals) {
+  if (char* message = beginMessage(path.vector)) {
+    char* slot = message + path.vector.argumentOffset();
+    for (std::size_t i = 0; i < N; i++) {
+      slot = writeOscArgument(slot, vals[i]);
+    }
+  }
+  _logger.verboseMessage(path, vals);
+}
+
+void DataSender::sendMessage(const VectorDataPaths<3>& path,
+                             const myo::Vector3<float>& vec) {
+  if (_settings.schema == PathSchema::vectors) {
+    if (char* message = beginMessage(path.vector)) {
+      char* slot = message + path.vector.argumentOffset();
+      slot = writeOscArgument(slot, vec.x());
+      slot = writeOscArgument(slot, vec.y());
+      writeOscArgument(slot, vec.z());
+    }
+  } else {
+    send(path[0], vec.x());
+    send(path[1], vec.y());
+    send(path[2], vec.z());
+  }
   _logger.verboseMessage(path, vec);
 }
 
-void DataSender::sendMessage(const std::array<std::string, 4>& path,
-                             myo::Quaternion<float> quat) {
-  send(path[0], quat.x());
-  send(path[1], quat.y());
-  send(path[2], quat.z());
-  send(path[3], quat.w());
+void DataSender::sendMessage(const VectorDataPaths<4>& path,
+                             const myo::Quaternion<float>& quat) {
+  if (_settings.schema == PathSchema::vectors) {
+    if (char* message = beginMessage(path.vector)) {
+      char* slot = message + path.vector.argumentOffset();
+      slot = writeOscArgument(slot, quat.x());
+      slot = writeOscArgument(slot, quat.y());
+      slot = writeOscArgument(slot, quat.z());
+      writeOscArgument(slot, quat.w());
+    }
+  } else {
+    send(path[0], quat.x());
+    send(path[1], quat.y());
+    send(path[2], quat.z());
+    send(path[3], quat.w());
+  }
   _logger.verboseMessage(path, quat);
 }
 
+void DataSender::sendEmgBlob(const MessageTemplate& path, const int8_t* vals) {
+  if (char* message = beginMessage(path)) {
+    writeOscBlob(message + path.argumentOffset(), vals, emgLength);
+  }
+  _logger.verboseEmgFrame(path.address(), vals);
+}
+
+void DataSender::batchEmg(const EventRecord& record, const DeviceDataPaths* armPaths) {
+  if (record.deviceId >= _emgBatches.size()) {
+    _emgBatches.resize(record.deviceId + 1);
+  }
+  auto& batch = _emgBatches[record.deviceId];
+  if (batch.frames == 0) {
+    batch.firstTimestamp = record.timestamp;
+  }
+  batch.lastTimestamp = record.timestamp;
+  std::copy(record.payload.emg, record.payload.emg + emgLength,
+            batch.samples.begin() + batch.frames * emgLength);
+  if (++batch.frames < _settings.emgBatchFrames) {
+    return;
+  }
+  sendEmgBatch(record.paths->emgBatch, batch);
+  if (armPaths) {
+    sendEmgBatch(armPaths->emgBatch, batch);
+  }
+  batch.frames = 0;
+}
+
+void DataSender::sendEmgBatch(const MessageTemplate& path, const EmgBatch& batch) {
+  // average period between the frames of the batch
+  std::int32_t period = batch.frames > 1
+    ? static_cast<std::int32_t>((batch.lastTimestamp - batch.firstTimestamp) / (batch.frames - 1))
+    : 0;
+  if (char* message = beginMessage(path)) {
+    char* slot = message + path.argumentOffset();
+    slot = writeOscArgument(slot, static_cast<std::int64_t>(batch.firstTimestamp));
+    slot = writeOscArgument(slot, period);
+    writeOscBlob(slot, batch.samples.data(), batch.frames * emgLength);
+  }
+  _logger.verboseEmgBatch(path.address(), batch.frames, period);
+}
+
+void DataSender::envelopeEmg(const EventRecord& record) {
+  if (record.deviceId >= _emgEnvelopes.size()) {
+    _emgEnvelopes.resize(record.deviceId + 1,
+                         EmgEnvelope(_settings.emgEnvelopeWindow, _settings.emgEnvelopeEvery));
+  }
+  auto& envelope = _emgEnvelopes[record.deviceId];
+  if (!envelope.add(record.payload.emg)) {
+    return;
+  }
+  std::array<float, emgLength> rms;
+  std::array<float, emgLength> mav;
+  envelope.rms(rms.data());
+  envelope.meanAbsolute(mav.data());
+  auto arm = static_cast<myo::Arm>(record.arm);
+  beginEvent();
+  sendMessage(record.paths->emgRms, rms.data());
+  sendMessage(record.paths->emgMav, mav.data());
+  if (arm == myo::Arm::armLeft || arm == myo::Arm::armRight) {
+    sendMessage(_dataPaths[arm].emgRms, rms.data());
+    sendMessage(_dataPaths[arm].emgMav, mav.data());
+  }
+  endEvent();
+}
+
+void DataSender::classifyEmg(const EventRecord& record) {
+  if (record.deviceId >= _gestureWindows.size()) {
+    _gestureWindows.resize(record.deviceId + 1,
+                           EmgEnvelope(_gestures->window(), _gestures->every()));
+  }
+  auto& window = _gestureWindows[record.deviceId];
+  if (!window.add(record.payload.emg)) {
+    return;
+  }
+  std::array<float, GestureModel::numFeatures> features;
+  window.meanAbsolute(features.data());
+  window.rms(features.data() + emgLength);
+  auto prediction = _gestures->predict(features.data());
+  auto arm = static_cast<myo::Arm>(record.arm);
+  beginEvent();
+  sendGesture(record.paths->gesture, prediction);
+  if (arm == myo::Arm::armLeft || arm == myo::Arm::armRight) {
+    sendGesture(_dataPaths[arm].gesture, prediction);
+  }
+  endEvent();
+}
+
+void DataSender::sendGesture(const MessageTemplate& path, GestureModel::Prediction prediction) {
+  if (char* message = beginMessage(path)) {
+    char* slot = message + path.argumentOffset();
+    slot = writeOscArgument(slot, prediction.gesture);
+    writeOscArgument(slot, prediction.confidence);
+  }
+  _logger.verboseGesture(path.address(), prediction.gesture, prediction.confidence);
+}
+
+void DataSender::sendSpectra() {
+  EmgSpectrum::Result result;
+  while (_spectrum->pop(result)) {
+    auto arm = static_cast<myo::Arm>(result.arm);
+    beginEvent();
+    sendMessage(result.paths->emgBands, result.bandPower);
+    sendMessage(result.paths->emgMeanFreq, result.meanFrequency);
+    sendMessage(result.paths->emgMedianFreq, result.medianFrequency);
+    if (arm == myo::Arm::armLeft || arm == myo::Arm::armRight) {
+      const auto& armPaths = _dataPaths[arm];
+      sendMessage(armPaths.emgBands, result.bandPower);
+      sendMessage(armPaths.emgMeanFreq, result.meanFrequency);
+      sendMessage(armPaths.emgMedianFreq, result.medianFrequency);
+    }
+    endEvent();
+  }
+}
+
+void DataSender::process(const EventRecord& record) {
+  TraceSpan span("encode", record.deviceId, record.type);
+  if (record.type == EventType::latencyStats) {
+    sendLatencyStats();
+    return;
+  }
+  const auto& paths = *record.paths;
+  auto arm = static_cast<myo::Arm>(record.arm);
+  auto armValid = arm == myo::Arm::armLeft || arm == myo::Arm::armRight;
+  const auto& armPaths = _dataPaths[arm];
+  const auto& payload = record.payload;
+
+  beginEvent();
+  switch (record.type) {
+    case EventType::pair:
+      sendMessage(paths.paired, true);
+      break;
+    case EventType::unpair:
+      sendMessage(paths.paired, false);
+      break;
+    case EventType::connect:
+      sendMessage(paths.connected, true);
+      break;
+    case EventType::disconnect:
+      sendMessage(paths.connected, false);
+      _rateLimiter.drop(record.deviceId);
+      if (record.deviceId < _emgBatches.size()) {
+        _emgBatches[record.deviceId].frames = 0;
+      }
+      if (record.deviceId < _emgEnvelopes.size()) {
+        _emgEnvelopes[record.deviceId].reset();
+      }
+      if (record.deviceId < _gestureWindows.size()) {
+        _gestureWindows[record.deviceId].reset();
+      }
+      break;
+    case EventType::armSync:
+      sendMessage(paths.synced, true);
+      sendMessage(paths.arm, payload.armSync.arm);
+      sendMessage(paths.deviceDirection, payload.armSync.xDirection);
+      sendMessage(paths.armRotation, payload.armSync.rotation);
+      sendMessage(paths.warmupState, payload.armSync.warmupState);
+      break;
+    case EventType::armUnsync:
+      sendMessage(paths.synced, false);
+      break;
+    case EventType::unlock:
+      sendMessage(paths.locked, false);
+      break;
+    case EventType::lock:
+      sendMessage(paths.locked, true);
+      break;
+    case EventType::pose:
+      sendMessage(paths.poses[payload.pose.type], payload.pose.active);
+      break;
+    case EventType::orientation:
+      sendOrientation(payload.quat, paths, armValid ? &armPaths : nullptr);
+      break;
+    case EventType::accelerometer:
+      sendVector(payload.vec, paths.accel, armValid ? &armPaths.accel : nullptr);
+      break;
+    case EventType::gyroscope:
+      sendVector(payload.vec, paths.gyro, armValid ? &armPaths.gyro : nullptr);
+      break;
+    case EventType::imu: {
+      auto streams = payload.imu.streams;
+      if (streams & streamBit(StreamClass::orientation)) {
+        sendOrientation(payload.imu.quat, paths, armValid ? &armPaths : nullptr);
+      }
+      if (streams & streamBit(StreamClass::accel)) {
+        sendVector(payload.imu.accel, paths.accel, armValid ? &armPaths.accel : nullptr);
+      }
+      if (streams & streamBit(StreamClass::gyro)) {
+        sendVector(payload.imu.gyro, paths.gyro, armValid ? &armPaths.gyro : nullptr);
+      }
+      break;
+    }
+    case EventType::rssi:
+      sendMessage(paths.rssi, payload.rssi);
+      if (armValid) {
+        sendMessage(armPaths.rssi, payload.rssi);
+      }
+      break;
+    case EventType::batteryLevel:
+      sendMessage(paths.battery, payload.battery);
+      break;
+    case EventType::emg:
+      if (_settings.emgBatchFrames > 0) {
+        batchEmg(record, armValid ? &armPaths : nullptr);
+        break;
+      }
+      if (_settings.emgBlob) {
+        sendEmgBlob(paths.emgBlob, payload.emg);
+        if (armValid) {
+          sendEmgBlob(armPaths.emgBlob, payload.emg);
+        }
+        break;
+      }
+      sendMessage(paths.emg, payload.emg);
+      if (armValid) {
+        sendMessage(armPaths.emg, payload.emg);
+      }
+      break;
+    case EventType::warmupCompleted:
+      sendMessage(paths.warmupResult, payload.warmupResult);
+      break;
+    default:
+      break;
+  }
+  endEvent();
+
+  StreamClass streamClass;
+  if (record.type == EventType::imu) {
+    for (auto c : imuStreams) {
+      if (payload.imu.streams & streamBit(c)) {
+        addUnsent(static_cast<std::size_t>(c), record.received);
+      }
+    }
+  } else if (streamClassOf(record.type, streamClass)) {
+    addUnsent(static_cast<std::size_t>(streamClass), record.received);
+  } else {
+    addUnsent(numStreamClasses, record.received);
+  }
+}
+
+void DataSender::addUnsent(std::size_t latencyClass, std::uint64_t received) {
+  if (_unsent.size() < _unsent.capacity()) {
+    _unsent.push_back({latencyClass, received});
+  }
+}
+
+void DataSender::sendOrientation(const float* quat, const DeviceDataPaths& paths,
+                                 const DeviceDataPaths* armPaths) {
+  myo::Quaternion<float> rotation(quat[0], quat[1], quat[2], quat[3]);
+  // yaw, pitch and roll
+  float euler[3];
+  quaternionsToEuler(quat, euler, 1, _settings.euler);
+  myo::Vector3<float> vec(euler[0], euler[1], euler[2]);
+  sendMessage(paths.orientQuat, rotation);
+  sendMessage(paths.orientVec, vec);
+  if (armPaths) {
+    sendMessage(armPaths->orientQuat, rotation);
+    sendMessage(armPaths->orientVec, vec);
+  }
+}
+
+void DataSender::sendVector(const float* vec, const VectorDataPaths<3>& path,
+                            const VectorDataPaths<3>* armPath) {
+  myo::Vector3<float> value(vec[0], vec[1], vec[2]);
+  sendMessage(path, value);
+  if (armPath) {
+    sendMessage(*armPath, value);
+  }
+}
+
 void DataSender::onPair(MyoPtr device, uint64_t timestamp,
-                        myo::FirmwareVersion firmwareVersion) {
+                        myo::FirmwareVersion) {
   const auto& state = _devices[device];
   _logger.log() << "Paired " << state << std::endl;
-  sendMessage(state.paths.paired, true);
+  dispatch(makeRecord(state, EventType::pair, timestamp));
 }
 
 void DataSender::onUnpair(MyoPtr device, uint64_t timestamp) {
   const auto& state = _devices[device];
   _logger.log() << "Unpaired " << state << std::endl;
-  sendMessage(state.paths.paired, false);
+  dispatch(makeRecord(state, EventType::unpair, timestamp));
 }
 
-void DataSender::onConnect(MyoPtr device, uint64_t timestamp, myo::FirmwareVersion firmwareVersion) {
+void DataSender::onConnect(MyoPtr device, uint64_t timestamp, myo::FirmwareVersion) {
   const auto& state = _devices[device];
   _logger.log() << "Connect " << state << std::endl;
-  device->setStreamEmg(myo::Myo::streamEmgEnabled);
+  // there's no Myo behind a replayed device
+  if (_settings.replayFile.empty()) {
+    device->setStreamEmg(myo::Myo::streamEmgEnabled);
+  }
   // unlock..?
-  sendMessage(state.paths.connected, true);
+  dispatch(makeRecord(state, EventType::connect, timestamp));
 }
 
 void DataSender::onDisconnect(MyoPtr device, uint64_t timestamp) {
   const auto& state = _devices[device];
   _logger.log() << "Disconnect " << state << std::endl;
-  sendMessage(state.paths.connected, false);
+  auto record = makeRecord(state, EventType::disconnect, timestamp);
+  if (_spectrum) {
+    _spectrum->push(record);
+  }
+  dispatch(record);
+  _devices.latest().clear(state.deviceId);
   _devices.unregisterDevice(device);
 }
 
 void DataSender::onArmSync(MyoPtr device, uint64_t timestamp, myo::Arm arm, myo::XDirection xDirection, float rotation, myo::WarmupState warmupState) {
-  const auto& state = _devices[device];
+  auto& state = _devices[device];
   _logger.log() << "Arm sync " << state << std::endl;
-  const auto& paths = state.paths;
-  sendMessage(paths.synced, true);
-  sendEnumMessage(paths.arm, arm);
-  sendEnumMessage(paths.deviceDirection, xDirection);
-  sendMessage(paths.armRotation, rotation);
-  sendEnumMessage(paths.warmupState, warmupState);
+  state.arm = arm;
+  auto record = makeRecord(state, EventType::armSync, timestamp);
+  record.payload.armSync.arm = static_cast<std::int8_t>(arm);
+  record.payload.armSync.xDirection = static_cast<std::int8_t>(xDirection);
+  record.payload.armSync.warmupState = static_cast<std::int8_t>(warmupState);
+  record.payload.armSync.rotation = rotation;
+  dispatch(record);
 }
 
 void DataSender::onArmUnsync(MyoPtr device, uint64_t timestamp) {
-  const auto& state = _devices[device];
+  auto& state = _devices[device];
   _logger.log() << "Arm unsync " << state << std::endl;
-  sendMessage(state.paths.synced, false);
+  state.arm = myo::Arm::armUnknown;
+  dispatch(makeRecord(state, EventType::armUnsync, timestamp));
 }
 
 void DataSender::onUnlock(MyoPtr device, uint64_t timestamp) {
   const auto& state = _devices[device];
   _logger.log() << "Unlock " << state << std::endl;
-  sendMessage(state.paths.locked, false);
+  dispatch(makeRecord(state, EventType::unlock, timestamp));
 }
 
 void DataSender::onLock(MyoPtr device, uint64_t timestamp) {
   const auto& state = _devices[device];
   _logger.log() << "Lock " << state << std::endl;
-  sendMessage(state.paths.locked, true);
+  dispatch(makeRecord(state, EventType::lock, timestamp));
 }
 
 void DataSender::onPose(MyoPtr device, uint64_t timestamp, myo::Pose pose) {
@@ -124,15 +845,21 @@ void DataSender::onPose(MyoPtr device, uint64_t timestamp, myo::Pose pose) {
   }
   auto& state = _devices[device];
   auto i = static_cast<std::size_t>(pose.type());
-  sendMessage(state.paths.poses[i], true);
+  auto record = makeRecord(state, EventType::pose, timestamp);
+  record.payload.pose.type = static_cast<std::uint8_t>(i);
+  record.payload.pose.active = true;
+  dispatch(record);
   state.poses[i] = true;
 }
 
 void DataSender::flushPoseStates() {
   for (auto& state : _devices) {
-    for (auto i = 0; i < numPoses; i++) {
+    for (std::size_t i = 0; i < numPoses; i++) {
       if (state.poses[i]) {
-        sendMessage(state.paths.poses[i], false);
+        auto record = makeRecord(state, EventType::pose, 0);
+        record.payload.pose.type = static_cast<std::uint8_t>(i);
+        record.payload.pose.active = false;
+        dispatch(record);
         state.poses[i] = false;
       }
     }
@@ -140,14 +867,46 @@ void DataSender::flushPoseStates() {
 }
 
 void DataSender::onOrientationData(MyoPtr device, uint64_t timestamp, const myo::Quaternion<float> &rotation) {
-  auto vec = quaternionToVector(rotation);
-  const auto& state = _devices[device];
-  sendMessage(state.paths.orientQuat, rotation);
-  sendMessage(state.paths.orientVec, vec);
-  if (state.armValid()) {
-    const auto& armPaths = _dataPaths[state.arm];
-    sendMessage(armPaths.orientQuat, rotation);
-    sendMessage(armPaths.orientVec, vec);
+  auto& state = _devices[device];
+  auto record = makeRecord(state, EventType::orientation, timestamp);
+  record.payload.quat[0] = rotation.x();
+  record.payload.quat[1] = rotation.y();
+  record.payload.quat[2] = rotation.z();
+  record.payload.quat[3] = rotation.w();
+  _devices.latest().setOrientation(state.deviceId, timestamp, record.payload.quat);
+  if (changed(state, StreamClass::orientation, record.payload.quat, 4, timestamp)) {
+    dispatch(record);
+  }
+}
+
+void DataSender::onImuData(MyoPtr device, uint64_t timestamp, const myo::Quaternion<float>& rotation,
+                           const myo::Vector3<float>& accel, const myo::Vector3<float>& gyro) {
+  auto& state = _devices[device];
+  auto record = makeRecord(state, EventType::imu, timestamp);
+  auto& imu = record.payload.imu;
+  imu.quat[0] = rotation.x();
+  imu.quat[1] = rotation.y();
+  imu.quat[2] = rotation.z();
+  imu.quat[3] = rotation.w();
+  imu.accel[0] = accel.x();
+  imu.accel[1] = accel.y();
+  imu.accel[2] = accel.z();
+  imu.gyro[0] = gyro.x();
+  imu.gyro[1] = gyro.y();
+  imu.gyro[2] = gyro.z();
+  _devices.latest().setImu(state.deviceId, timestamp, imu.quat, imu.accel, imu.gyro);
+  imu.streams = 0;
+  if (changed(state, StreamClass::orientation, imu.quat, 4, timestamp)) {
+    imu.streams |= streamBit(StreamClass::orientation);
+  }
+  if (changed(state, StreamClass::accel, imu.accel, 3, timestamp)) {
+    imu.streams |= streamBit(StreamClass::accel);
+  }
+  if (changed(state, StreamClass::gyro, imu.gyro, 3, timestamp)) {
+    imu.streams |= streamBit(StreamClass::gyro);
+  }
+  if (imu.streams) {
+    dispatch(record);
   }
 }
 
@@ -155,46 +914,67 @@ void DataSender::onOrientationData(MyoPtr device, uint64_t timestamp, const myo:
 void DataSender::onAccelerometerData(MyoPtr device, uint64_t timestamp,
                                      const myo::Vector3<float>& accel)
 {
-  const auto& state = _devices[device];
-  sendMessage(state.paths.accel, accel);
-  if (state.armValid()) {
-    const auto& armPaths = _dataPaths[state.arm];
-    sendMessage(armPaths.accel, accel);
+  auto& state = _devices[device];
+  auto record = makeRecord(state, EventType::accelerometer, timestamp);
+  record.payload.vec[0] = accel.x();
+  record.payload.vec[1] = accel.y();
+  record.payload.vec[2] = accel.z();
+  _devices.latest().setAccel(state.deviceId, timestamp, record.payload.vec);
+  if (changed(state, StreamClass::accel, record.payload.vec, 3, timestamp)) {
+    dispatch(record);
   }
 }
 
 void DataSender::onGyroscopeData(MyoPtr device, uint64_t timestamp,
                                  const myo::Vector3<float> &gyro) {
-  const auto& state = _devices[device];
-  sendMessage(state.paths.gyro, gyro);
-  if (state.armValid()) {
-    const auto& armPaths = _dataPaths[state.arm];
-    sendMessage(armPaths.gyro, gyro);
+  auto& state = _devices[device];
+  auto record = makeRecord(state, EventType::gyroscope, timestamp);
+  record.payload.vec[0] = gyro.x();
+  record.payload.vec[1] = gyro.y();
+  record.payload.vec[2] = gyro.z();
+  _devices.latest().setGyro(state.deviceId, timestamp, record.payload.vec);
+  if (changed(state, StreamClass::gyro, record.payload.vec, 3, timestamp)) {
+    dispatch(record);
   }
 }
 
 void DataSender::onRssi(MyoPtr device, uint64_t timestamp, int8_t rssi) {
-  const auto& state = _devices[device];
-  sendMessage(state.paths.rssi, rssi);
-  if (state.armValid()) {
-    const auto& armPaths = _dataPaths[state.arm];
-    sendMessage(armPaths.rssi, rssi);
+  auto& state = _devices[device];
+  _devices.latest().setRssi(state.deviceId, timestamp, rssi);
+  if (!changed(state, StreamClass::rssi, &rssi, 1, timestamp)) {
+    return;
   }
+  auto record = makeRecord(state, EventType::rssi, timestamp);
+  record.payload.rssi = rssi;
+  dispatch(record);
 }
 
 void DataSender::onBatteryLevelReceived(MyoPtr device, uint64_t timestamp, uint8_t level) {
-  sendMessage(devicePaths(device).battery, level);
+  const auto& state = _devices[device];
+  _devices.latest().setBattery(state.deviceId, timestamp, level);
+  auto record = makeRecord(state, EventType::batteryLevel, timestamp);
+  record.payload.battery = level;
+  dispatch(record);
 }
 
 void DataSender::onEmgData(MyoPtr device, uint64_t timestamp, const int8_t *emg) {
-  const auto& state = _devices[device];
-  sendMessage(state.paths.emg, emg);
-  if (state.armValid()) {
-    const auto& armPaths = _dataPaths[state.arm];
-    sendMessage(armPaths.emg, emg);
+  auto& state = _devices[device];
+  _devices.latest().setEmg(state.deviceId, timestamp, emg);
+  auto record = makeRecord(state, EventType::emg, timestamp);
+  std::copy(emg, emg + emgLength, record.payload.emg);
+  if (_spectrum) {
+    _spectrum->push(record);
+  }
+  record.suppressed = !changed(state, StreamClass::emg, emg, emgLength, timestamp);
+  // the EMG envelope and gestures still need the frame
+  if (record.suppressed && _settings.emgEnvelopeWindow == 0 && !_gestures) {
+    return;
   }
+  dispatch(record);
 }
 
 void DataSender::onWarmupCompleted(MyoPtr device, uint64_t timestamp, myo::WarmupResult warmupResult) {
-  sendEnumMessage(devicePaths(device).warmupResult, warmupResult);
+  auto record = makeRecord(_devices[device], EventType::warmupCompleted, timestamp);
+  record.payload.warmupResult = static_cast<std::int8_t>(warmupResult);
+  dispatch(record);
 }
@@ -5,30 +5,76 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <type_traits>
+#include <vector>
 #include "ip/UdpSocket.h"
-#include "osc/OscOutboundPacketStream.h"
 
+#include "ChangeFilter.h"
 #include "Common.h"
 #include "DataPaths.h"
 #include "DeviceManager.h"
+#include "EmgEnvelope.h"
+#include "EmgSpectrum.h"
+#include "EventRecord.h"
+#include "GestureModel.h"
+#include "LatencyHistogram.h"
 #include "Logger.h"
+#include "MessageTemplate.h"
+#include "PacketBuilder.h"
+#include "RateLimiter.h"
+#include "RingBuffer.h"
 #include "Settings.h"
+#include "Subscriptions.h"
 
-#define OUTPUT_BUFFER_SIZE 1024
+#define OUTPUT_BUFFER_SIZE 8192
+#define MAX_PACKET_SIZE 1024
 
 class DataSender : public myo::DeviceListener {
 public:
+  /// With subscriptions, the messages also go to their subscribers, in the
+  /// destination slots after those of the settings. With a gesture model,
+  /// the EMG of each device is classified with it.
   DataSender(DeviceManager& devices,
              const Settings& settings,
              const DataPaths& dataPaths,
-             Logger& logger);
+             Logger& logger,
+             const Subscriptions* subscriptions = nullptr,
+             const GestureModel* gestures = nullptr);
 
-  virtual ~DataSender() {}
+  virtual ~DataSender();
 
   void flushPoseStates();
 
+  /// Sends rate limited samples that are due. Only needed with --sync; the
+  /// sender thread keeps its own schedule.
+  void update();
+
+  /// Logs the sender queue counters, and how many samples the deadband
+  /// filter has suppressed so far.
+  void logStats();
+
+  /// Sends the latency percentiles of each stream since the last call, from
+  /// the thread that sends messages. Call it from the Myo event thread.
+  void publishLatency();
+
+  const ChangeFilter& changeFilter() const { return _changeFilter; }
+
+  /// Number of events waiting for the sender thread.
+  std::size_t queueOccupancy() const { return _queue.size(); }
+
+  /// Number of events dropped because the sender thread fell behind.
+  std::uint64_t queueOverflows() const { return _queue.overflows(); }
+
+  /// Number of UDP datagrams sent, counting each destination separately,
+  /// and their total size in bytes.
+  std::uint64_t datagramsSent() const { return _datagramsSent.load(std::memory_order_relaxed); }
+  std::uint64_t bytesSent() const { return _bytesSent.load(std::memory_order_relaxed); }
+
   /// Called when a Myo has been paired.
   /// @param device The Myo for this event.
   /// @param timestamp The timestamp of when the event is received by the SDK. Timestamps are 64 bit unsigned
@@ -109,6 +155,18 @@ public:
   /// @param rotation The orientation data of \a myo, as a Quaternion.
   void onOrientationData(MyoPtr device, uint64_t timestamp, const myo::Quaternion<float>& rotation) override;
 
+  /// Called when a paired Myo has provided new orientation, accelerometer and gyroscope data, which it always
+  /// does together. The messages of the three go out together, in one bundle when bundling is enabled.
+  /// @param device The Myo for this event.
+  /// @param timestamp The timestamp of when the event is received by the SDK. Timestamps are 64 bit unsigned
+  /// integers that correspond to a number of microseconds since some (unspecified) period in time. Timestamps
+  /// are monotonically non-decreasing.
+  /// @param rotation The orientation data of \a myo, as a Quaternion.
+  /// @param accel The accelerometer data of \a myo, in units of g.
+  /// @param gyro The gyroscope data of \a myo, in units of deg/s.
+  void onImuData(MyoPtr device, uint64_t timestamp, const myo::Quaternion<float>& rotation,
+                 const myo::Vector3<float>& accel, const myo::Vector3<float>& gyro) override;
+
   /// Called when a paired Myo has provided new accelerometer data in units of g.
   /// @param device The Myo for this event.
   /// @param timestamp The timestamp of when the event is received by the SDK. Timestamps are 64 bit unsigned
@@ -161,36 +219,123 @@ public:
   void onWarmupCompleted(MyoPtr device, uint64_t timestamp, myo::WarmupResult warmupResult) override;
 
 private:
-  const DeviceDataPaths& devicePaths(MyoPtr device) {
-    const auto& state = _devices[device];
-    return state.paths;
+  static const std::size_t eventQueueSize = 4096;
+
+  // Whether a sample differs enough from the last one sent for the device
+  // to be sent, see ChangeFilter.
+  template<typename T>
+  bool changed(DeviceState& state, StreamClass streamClass,
+               const T* values, std::size_t count, uint64_t timestamp) {
+    return _changeFilter.passes(streamClass, values, count, timestamp,
+                                state.lastSent[static_cast<std::size_t>(streamClass)]);
   }
 
-  osc::OutboundPacketStream beginMessage(const std::string& path);
+  EventRecord makeRecord(const DeviceState& state, EventType type, uint64_t timestamp) const;
 
-  void send(const osc::OutboundPacketStream& p);
+  // Hands an event to the sender thread, or encodes and sends it right away
+  // when there is none.
+  void dispatch(const EventRecord& record);
 
-  template<typename T>
-  void send(const std::string& path, T val) {
-    send(beginMessage(path) << val << osc::EndMessage);
-  }
+  // Sender thread main loop.
+  void run();
+
+  // Processes the record now, or holds it back if its stream is rate
+  // limited.
+  void accept(const EventRecord& record);
+  void emitDueSamples();
+
+  void process(const EventRecord& record);
+
+  // Sends IMU samples from a record payload to the paths of the device, and
+  // to those of its arm when it is synced.
+  void sendOrientation(const float* quat, const DeviceDataPaths& paths, const DeviceDataPaths* armPaths);
+  void sendVector(const float* vec, const VectorDataPaths<3>& path, const VectorDataPaths<3>* armPath);
+
+  // Notes that the messages of an event are waiting for the next flush(),
+  // for the latency histograms.
+  void addUnsent(std::size_t latencyClass, std::uint64_t received);
+
+  // Sends the latency histograms collected since the last time and adds
+  // them to the totals, which are logged on shutdown.
+  void sendLatencyStats();
+  void logLatency();
+
+  // EMG frames of one device collected for a batch message.
+  struct EmgBatch {
+    EmgBatch()
+    : frames(0)
+    , firstTimestamp(0)
+    , lastTimestamp(0) {}
+
+    std::size_t frames;
+    std::uint64_t firstTimestamp;
+    std::uint64_t lastTimestamp;
+    std::array<std::int8_t, Settings::maxEmgBatchFrames * emgLength> samples;
+  };
+
+  // Adds an EMG frame to the batch of its device, and sends the batch once
+  // it is full.
+  void batchEmg(const EventRecord& record, const DeviceDataPaths* armPaths);
+  void sendEmgBatch(const MessageTemplate& path, const EmgBatch& batch);
+
+  // Adds an EMG frame to the envelope of its device, and sends the envelope
+  // when it is due.
+  void envelopeEmg(const EventRecord& record);
+
+  // Adds an EMG frame to the gesture window of its device, and sends the
+  // gesture when the model is due to classify it.
+  void classifyEmg(const EventRecord& record);
+  void sendGesture(const MessageTemplate& path, GestureModel::Prediction prediction);
+
+  // Sends the EMG spectrum features that the worker has computed.
+  void sendSpectra();
+
+  // All packets produced by an event are sent together in one batch by the
+  // next flush(). When bundling is enabled, the messages between
+  // beginEvent() and endEvent() are also collected into a single OSC bundle.
+  void beginEvent();
+  void endEvent();
+  void flush();
+
+  // Destinations whose path prefix filter accepts the message, or that
+  // subscribed to it. Cached by template.
+  PacketBuilder::DestinationMask destinationsFor(const MessageTemplate& message);
+  PacketBuilder::DestinationMask matchDestinations(const MessageTemplate& message) const;
+
+  // Picks up changed subscriptions, after sending what was encoded for the
+  // old ones.
+  void updateSubscribers();
+
+  // Appends a copy of the message template to the batch and returns it,
+  // so the caller can fill in the arguments. Returns null when no
+  // destination wants the message.
+  char* beginMessage(const MessageTemplate& message);
+
+  void send(const MessageTemplate& path, bool val);
+  void send(const MessageTemplate& path, std::int32_t val);
+  void send(const MessageTemplate& path, float val);
 
   template<typename T>
-  void sendMessage(const std::string& path, T val) {
+  void sendMessage(const MessageTemplate& path, T val) {
     send(path, val);
-    _logger.verboseMessage(path, val);
+    _logger.verboseMessage(path.address(), val);
   }
-  void sendMessage(const std::array<std::string, emgLength>& path,
+  void sendMessage(const VectorDataPaths<emgLength>& path,
                    const int8_t* vals);
-  void sendMessage(const std::array<std::string, 3>& path,
-                   myo::Vector3<float> vec);
-  void sendMessage(const std::array<std::string, 4>& path,
-                   myo::Quaternion<float> quat);
+  // Per channel EMG features, always sent as one message of N floats, since
+  // a message per value would multiply the datagrams for little use.
+  template<std::size_t N>
+  void sendMessage(const VectorDataPaths<N>& path, const float* vals);
+  void sendEmgBlob(const MessageTemplate& path, const int8_t* vals);
+  void sendMessage(const VectorDataPaths<3>& path,
+                   const myo::Vector3<float>& vec);
+  void sendMessage(const VectorDataPaths<4>& path,
+                   const myo::Quaternion<float>& quat);
 
   template<
     typename T,
     typename = std::enable_if_t<std::is_enum<T>::value>>
-  void sendEnumMessage(const std::string& path, T val) {
+  void sendEnumMessage(const MessageTemplate& path, T val) {
     sendMessage(path, static_cast<std::int8_t>(val));
   }
 
@@ -199,6 +344,51 @@ private:
   const DataPaths& _dataPaths;
   Logger& _logger;
   char _buffer[OUTPUT_BUFFER_SIZE];
-  std::unique_ptr<UdpTransmitSocket> _socket;
+  PacketBuilder _packet;
+  // one unconnected socket for all destinations
+  std::unique_ptr<UdpSocket> _socket;
+  std::vector<IpEndpointName> _endpoints;
+  PacketBuilder::DestinationMask _allDestinations;
+  // whether any destination has a path prefix filter
+  bool _filtered;
+  const Subscriptions* _subscriptions;
+  std::uint64_t _subscriptionVersion;
+  // by slot, with their endpoints after the fixed ones in _endpoints
+  std::vector<Subscriber> _subscribers;
+  // destinations of each message template, by template id
+  static constexpr std::uint64_t unknownDestinations = ~std::uint64_t(0);
+  std::vector<std::uint64_t> _destinationCache;
+  std::vector<UdpDatagram> _datagrams;
+  std::atomic<std::uint64_t> _datagramsSent;
+  std::atomic<std::uint64_t> _bytesSent;
+  // Events encoded since the last flush, whose latency is recorded once
+  // their messages are sent. Reserved up front; events beyond that aren't
+  // measured.
+  struct Unsent {
+    std::size_t latencyClass;
+    std::uint64_t received;
+  };
+  std::vector<Unsent> _unsent;
+  // indexed by stream class, then other events
+  std::array<LatencyHistogram, numLatencyClasses> _latency;
+  std::array<LatencyHistogram, numLatencyClasses> _latencyTotal;
+  RateLimiter _rateLimiter;
+  // indexed by device id, used on the thread that encodes messages
+  std::vector<EmgBatch> _emgBatches;
+  std::vector<EmgEnvelope> _emgEnvelopes;
+  const GestureModel* _gestures;
+  std::vector<EmgEnvelope> _gestureWindows;
+  // fed on the Myo event thread, results taken on the thread that encodes
+  // the messages
+  std::unique_ptr<EmgSpectrum> _spectrum;
+  // used on the Myo event thread
+  ChangeFilter _changeFilter;
+
+  RingBuffer<EventRecord, eventQueueSize> _queue;
+  std::thread _thread;
+  std::atomic<bool> _running;
+  std::atomic<bool> _sleeping;
+  std::mutex _wakeMutex;
+  std::condition_variable _wake;
 };
 
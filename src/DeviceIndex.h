@@ -0,0 +1,109 @@
+//
+//  DeviceIndex.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Common.h"
+
+// Hash map from Myo pointers to device ids, with open addressing and
+// linear probing, kept at most half full. Finding a device takes one or
+// two probes on average however many devices there are.
+class DeviceIndex {
+public:
+  DeviceIndex()
+  : _slots(minCapacity)
+  , _shift(64 - minCapacityBits)
+  , _size(0) {}
+
+  // Returns unknownMyoId when the device isn't in the index.
+  MyoId find(MyoPtr device) const {
+    for (auto i = home(device); ; i = next(i)) {
+      const auto& slot = _slots[i];
+      if (slot.device == device) {
+        return slot.id;
+      }
+      if (!slot.device) {
+        return unknownMyoId;
+      }
+    }
+  }
+
+  // The device must not be in the index yet.
+  void insert(MyoPtr device, MyoId id) {
+    if (2 * (_size + 1) > _slots.size()) {
+      grow();
+    }
+    place({device, id});
+    _size++;
+  }
+
+  void erase(MyoPtr device) {
+    auto i = home(device);
+    while (_slots[i].device != device) {
+      if (!_slots[i].device) {
+        return;
+      }
+      i = next(i);
+    }
+    // Move later entries of the probe sequence back into the gap, so that
+    // no lookup stops early at it.
+    for (auto j = next(i); _slots[j].device; j = next(j)) {
+      auto k = home(_slots[j].device);
+      bool stays = i < j ? (i < k && k <= j) : (i < k || k <= j);
+      if (!stays) {
+        _slots[i] = _slots[j];
+        i = j;
+      }
+    }
+    _slots[i] = Slot();
+    _size--;
+  }
+
+private:
+  static const unsigned minCapacityBits = 4;
+  static const std::size_t minCapacity = std::size_t(1) << minCapacityBits;
+
+  struct Slot {
+    MyoPtr device = nullptr;
+    MyoId id = unknownMyoId;
+  };
+
+  // Fibonacci hashing: the multiplication mixes the pointer bits, which are
+  // mostly alike between allocations, into the top bits.
+  std::size_t home(MyoPtr device) const {
+    auto bits = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(device));
+    return static_cast<std::size_t>((bits * 11400714819323198485ull) >> _shift);
+  }
+
+  std::size_t next(std::size_t i) const {
+    return (i + 1) & (_slots.size() - 1);
+  }
+
+  void place(const Slot& entry) {
+    auto i = home(entry.device);
+    while (_slots[i].device) {
+      i = next(i);
+    }
+    _slots[i] = entry;
+  }
+
+  void grow() {
+    std::vector<Slot> old(2 * _slots.size());
+    old.swap(_slots);
+    _shift--;
+    for (const auto& slot : old) {
+      if (slot.device) {
+        place(slot);
+      }
+    }
+  }
+
+  std::vector<Slot> _slots;
+  unsigned _shift;
+  std::size_t _size;
+};
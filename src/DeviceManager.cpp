@@ -15,29 +15,30 @@ std::ostream& operator<<(std::ostream& os, const DeviceState& state) {
 }
 
 DeviceState& DeviceManager::registerDevice(MyoPtr device) {
-  for (DeviceState& state : _devices) {
-    if (state.device == device) {
-      return state;
-    }
+  auto known = _index.find(device);
+  if (known != unknownMyoId) {
+    return _devices[known];
   }
-  for (MyoId id = 0; id < _devices.size(); id++) {
+  // a new device takes the lowest free id
+  if (!_freeIds.empty()) {
+    MyoId id = _freeIds.top();
+    _freeIds.pop();
     DeviceState& state = _devices[id];
-    if (!state.device) {
-      state.device = device;
-      return state;
-    }
+    state.device = device;
+    _index.insert(device, id);
+    return state;
   }
+  _index.insert(device, _devices.size());
   _devices.emplace_back(_devices.size(), device, _dataPaths);
   return _devices.back();
 }
 
 MyoId DeviceManager::unregisterDevice(MyoPtr device) {
-  for (DeviceState& state : _devices) {
-    if (state.device == device) {
-      auto id = state.deviceId;
-      state.clear();
-      return id;
-    }
+  auto id = _index.find(device);
+  if (id != unknownMyoId) {
+    _devices[id].clear();
+    _index.erase(device);
+    _freeIds.push(id);
   }
-  return unknownMyoId;
+  return id;
 }
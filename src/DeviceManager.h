@@ -5,11 +5,16 @@
 
 #pragma once
 
+#include "ChangeFilter.h"
 #include "Common.h"
 #include "DataPaths.h"
+#include "DeviceIndex.h"
+#include "LatestValues.h"
 #include <array>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <queue>
 #include <vector>
 
 class DeviceState {
@@ -18,12 +23,15 @@ public:
   : deviceId(i)
   , paths(dataPaths[i])
   , device(d)
-  , arm(myo::Arm::armUnknown) {}
+  , arm(myo::Arm::armUnknown) {
+    poses.fill(false);
+  }
 
   void clear() {
     device = nullptr;
     poses.fill(false);
     arm = myo::Arm::armUnknown;
+    lastSent = SentSamples();
   }
 
   bool armValid() const {
@@ -31,11 +39,13 @@ public:
   }
 
   const MyoId deviceId;
-  const DeviceDataPaths paths;
+  const DeviceDataPaths& paths;
 
   MyoPtr device;
   myo::Arm arm;
   std::array<bool, numPoses> poses;
+  // used by the deadband filter, see ChangeFilter
+  SentSamples lastSent;
 };
 
 std::ostream& operator<<(std::ostream& os, const DeviceState& state);
@@ -51,9 +61,17 @@ public:
   DeviceState& operator[](MyoPtr device) {
     return registerDevice(device);
   }
+  // Latest sensor values of every device, by device id.
+  LatestValues& latest() { return _latest; }
+  const LatestValues& latest() const { return _latest; }
   DeviceStateList::iterator begin() { return _devices.begin(); }
   DeviceStateList::iterator end() { return _devices.end(); }
 private:
   DeviceStateList _devices;
+  // id of every registered device
+  DeviceIndex _index;
+  // ids of unregistered devices, lowest first
+  std::priority_queue<MyoId, std::vector<MyoId>, std::greater<MyoId>> _freeIds;
+  LatestValues _latest;
   DataPaths& _dataPaths;
 };
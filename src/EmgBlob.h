@@ -0,0 +1,45 @@
+//
+//  EmgBlob.h
+//  MyoOsc2
+//
+//  Decoding of the EMG blobs sent with --emg-blob and --emg-batch, for
+//  receivers built on oscpack. Doesn't depend on the Myo SDK.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "osc/OscReceivedElements.h"
+
+// Samples per EMG frame, one per sensor.
+const std::size_t emgBlobChannels = 8;
+
+// Copies up to maxFrames EMG frames from a blob argument into samples,
+// which must have room for maxFrames * emgBlobChannels values, and returns
+// the number of frames copied. Throws osc::WrongArgumentTypeException if
+// the argument is not a blob.
+inline std::size_t decodeEmgBlob(const osc::ReceivedMessageArgument& arg,
+                                 std::int8_t* samples, std::size_t maxFrames) {
+  const void* data;
+  osc::osc_bundle_element_size_t size;
+  arg.AsBlob(data, size);
+  std::size_t frames = static_cast<std::size_t>(size) / emgBlobChannels;
+  if (frames > maxFrames) {
+    frames = maxFrames;
+  }
+  std::memcpy(samples, data, frames * emgBlobChannels);
+  return frames;
+}
+
+// Decodes a /myo/N/emg ,b message into one frame. Returns false if the
+// message doesn't hold a complete frame.
+inline bool decodeEmgFrame(const osc::ReceivedMessage& message,
+                           std::int8_t (&frame)[emgBlobChannels]) {
+  if (message.ArgumentCount() != 1) {
+    return false;
+  }
+  auto arg = message.ArgumentsBegin();
+  return arg->IsBlob() && decodeEmgBlob(*arg, frame, 1) == 1;
+}
@@ -0,0 +1,61 @@
+//
+//  EmgEnvelope.cpp
+//  MyoOsc2
+//
+
+#include "EmgEnvelope.h"
+#include <algorithm>
+#include <cmath>
+
+EmgEnvelope::EmgEnvelope(std::size_t window, std::size_t every)
+: _window(std::max<std::size_t>(window, 1))
+, _every(std::max<std::size_t>(every, 1)) {
+  reset();
+}
+
+bool EmgEnvelope::add(const std::int8_t* frame) {
+  auto& slot = _window[_next];
+  // widened to locals first: int8 stores may alias the sums, which keeps
+  // compilers from vectorizing a loop that mixes them
+  std::array<std::int32_t, emgLength> values;
+  std::array<std::int32_t, emgLength> old;
+  for (std::size_t c = 0; c < emgLength; c++) {
+    values[c] = frame[c];
+    old[c] = slot[c];
+  }
+  for (std::size_t c = 0; c < emgLength; c++) {
+    _absSum[c] += std::abs(values[c]) - std::abs(old[c]);
+    _squareSum[c] += values[c] * values[c] - old[c] * old[c];
+  }
+  std::copy(frame, frame + emgLength, slot.begin());
+  _next = _next + 1 == _window.size() ? 0 : _next + 1;
+  _count = std::min(_count + 1, _window.size());
+  if (--_untilDue > 0) {
+    return false;
+  }
+  _untilDue = _every;
+  return true;
+}
+
+void EmgEnvelope::reset() {
+  std::fill(_window.begin(), _window.end(), EmgArray());
+  _next = 0;
+  _count = 0;
+  _untilDue = _every;
+  _absSum.fill(0);
+  _squareSum.fill(0);
+}
+
+void EmgEnvelope::rms(float* values) const {
+  float scale = _count ? 1.0f / _count : 0;
+  for (std::size_t c = 0; c < emgLength; c++) {
+    values[c] = std::sqrt(static_cast<float>(_squareSum[c]) * scale);
+  }
+}
+
+void EmgEnvelope::meanAbsolute(float* values) const {
+  float scale = _count ? 1.0f / _count : 0;
+  for (std::size_t c = 0; c < emgLength; c++) {
+    values[c] = static_cast<float>(_absSum[c]) * scale;
+  }
+}
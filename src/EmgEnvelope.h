@@ -0,0 +1,49 @@
+//
+//  EmgEnvelope.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Common.h"
+
+// Sliding window RMS and mean absolute value of the EMG channels of one
+// device. Running sums of the absolute values and squares of the frames in
+// the window are updated as frames come in and drop out, so a frame costs
+// the same whatever the window length. The sums are integers and never
+// drift, and all 8 channels are updated together in loops that compilers
+// vectorize.
+class EmgEnvelope {
+public:
+  // A window of frames, sent every `every` frames.
+  explicit EmgEnvelope(std::size_t window = 1, std::size_t every = 1);
+
+  // Adds a frame, dropping the oldest one when the window is full. Returns
+  // true when the envelope is due to be sent.
+  bool add(const std::int8_t* frame);
+
+  // Forgets all frames, e.g. when the device disconnects.
+  void reset();
+
+  // Number of frames in the window, fewer than its length until it fills.
+  std::size_t frames() const { return _count; }
+
+  // Of the frames in the window, by channel, in EMG units.
+  void rms(float* values) const;
+  void meanAbsolute(float* values) const;
+
+private:
+  // the frames of the window, zero until filled, so that dropping one of
+  // them before the window is full changes nothing
+  std::vector<EmgArray> _window;
+  std::size_t _next;
+  std::size_t _count;
+  std::size_t _every;
+  std::size_t _untilDue;
+  std::array<std::int32_t, emgLength> _absSum;
+  std::array<std::int32_t, emgLength> _squareSum;
+};
@@ -0,0 +1,236 @@
+//
+//  EmgSpectrum.cpp
+//  MyoOsc2
+//
+
+#include "EmgSpectrum.h"
+#include <algorithm>
+#include <cmath>
+#include "Trace.h"
+
+EmgSpectrum::EmgSpectrum(std::size_t window, std::size_t every, std::function<void()> ready)
+: _size(window)
+, _every(std::max<std::size_t>(every, 1))
+, _ready(std::move(ready))
+, _window(window)
+, _scale(0)
+, _bitReversed(window)
+, _cos(window / 2)
+, _sin(window / 2)
+, _re(window)
+, _im(window)
+, _power(emgLength * (window / 2 + 1))
+, _running(true)
+, _sleeping(false) {
+  const double pi = 3.14159265358979323846;
+  double windowPower = 0;
+  for (std::size_t n = 0; n < _size; n++) {
+    _window[n] = static_cast<float>(0.5 - 0.5 * std::cos(2 * pi * n / _size));
+    windowPower += _window[n] * _window[n];
+  }
+  // the one sided spectrum of a channel then adds up to its mean square
+  _scale = static_cast<float>(1 / (_size * windowPower));
+  std::size_t bits = 0;
+  while ((std::size_t(1) << bits) < _size) {
+    bits++;
+  }
+  for (std::size_t n = 0; n < _size; n++) {
+    std::size_t reversed = 0;
+    for (std::size_t b = 0; b < bits; b++) {
+      reversed |= ((n >> b) & 1) << (bits - 1 - b);
+    }
+    _bitReversed[n] = reversed;
+  }
+  for (std::size_t k = 0; k < _size / 2; k++) {
+    _cos[k] = static_cast<float>(std::cos(2 * pi * k / _size));
+    _sin[k] = static_cast<float>(std::sin(2 * pi * k / _size));
+  }
+  _thread = std::thread(&EmgSpectrum::run, this);
+}
+
+EmgSpectrum::~EmgSpectrum() {
+  stop();
+}
+
+void EmgSpectrum::stop() {
+  if (_thread.joinable()) {
+    _running = false;
+    {
+      std::lock_guard<std::mutex> lock(_wakeMutex);
+      _wake.notify_one();
+    }
+    _thread.join();
+  }
+}
+
+void EmgSpectrum::push(const EventRecord& record) {
+  Frame frame;
+  frame.paths = record.paths;
+  frame.timestamp = record.timestamp;
+  frame.deviceId = record.deviceId;
+  frame.arm = record.arm;
+  frame.disconnect = record.type == EventType::disconnect;
+  if (!frame.disconnect) {
+    std::copy(record.payload.emg, record.payload.emg + emgLength, frame.emg.begin());
+  }
+  if (!_frames.push(frame)) {
+    return;
+  }
+  // pairs with the fence in run(): either the worker sees the new frame
+  // before going to sleep, or we see that it is sleeping
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_sleeping.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(_wakeMutex);
+    _wake.notify_one();
+  }
+}
+
+void EmgSpectrum::run() {
+  Trace::nameThread("spectrum");
+  Frame frame;
+  while (true) {
+    // checked before draining, so that no frame queued before the stop is
+    // left behind
+    bool running = _running;
+    bool queued = false;
+    while (_frames.pop(frame)) {
+      queued = add(frame) || queued;
+    }
+    if (queued) {
+      _ready();
+    }
+    if (!running) {
+      break;
+    }
+    std::unique_lock<std::mutex> lock(_wakeMutex);
+    _sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_frames.empty() && _running) {
+      _wake.wait(lock);
+    }
+    _sleeping.store(false, std::memory_order_relaxed);
+  }
+}
+
+bool EmgSpectrum::add(const Frame& frame) {
+  if (frame.deviceId >= _devices.size()) {
+    _devices.resize(frame.deviceId + 1, DeviceWindow{std::vector<EmgArray>(_size), 0, 0, 0});
+  }
+  auto& device = _devices[frame.deviceId];
+  if (frame.disconnect) {
+    device.next = 0;
+    device.count = 0;
+    device.untilDue = 0;
+    return false;
+  }
+  device.frames[device.next] = frame.emg;
+  device.next = (device.next + 1) & (_size - 1);
+  device.count = std::min(device.count + 1, _size);
+  if (device.untilDue > 0) {
+    device.untilDue--;
+  }
+  // the first result once the window is full, then every _every frames
+  if (device.count < _size || device.untilDue > 0) {
+    return false;
+  }
+  device.untilDue = _every;
+
+  TraceSpan span("spectrum", frame.deviceId, EventType::emg);
+  Result result;
+  result.deviceId = frame.deviceId;
+  result.arm = frame.arm;
+  result.timestamp = frame.timestamp;
+  result.paths = frame.paths;
+  analyze(device.frames.data(), device.next, result);
+  return _results.push(result);
+}
+
+void EmgSpectrum::analyze(const EmgArray* frames, std::size_t oldest, Result& result) {
+  std::size_t half = _size / 2;
+  // two real channels at a time, as the real and imaginary parts of one
+  // complex FFT
+  for (std::size_t c = 0; c < emgLength; c += 2) {
+    std::int32_t sumA = 0;
+    std::int32_t sumB = 0;
+    for (std::size_t n = 0; n < _size; n++) {
+      sumA += frames[n][c];
+      sumB += frames[n][c + 1];
+    }
+    float meanA = static_cast<float>(sumA) / _size;
+    float meanB = static_cast<float>(sumB) / _size;
+    for (std::size_t n = 0; n < _size; n++) {
+      const auto& frame = frames[(oldest + n) & (_size - 1)];
+      auto i = _bitReversed[n];
+      _re[i] = _window[n] * (frame[c] - meanA);
+      _im[i] = _window[n] * (frame[c + 1] - meanB);
+    }
+    fft();
+    // Z = A + iB, where A and B are the spectra of the two channels:
+    // A[k] = (Z[k] + conj(Z[-k])) / 2 and B[k] = (Z[k] - conj(Z[-k])) / 2i
+    float* powerA = &_power[c * (half + 1)];
+    float* powerB = powerA + half + 1;
+    for (std::size_t k = 0; k <= half; k++) {
+      std::size_t m = (_size - k) & (_size - 1);
+      float aRe = 0.5f * (_re[k] + _re[m]);
+      float aIm = 0.5f * (_im[k] - _im[m]);
+      float bRe = 0.5f * (_im[k] + _im[m]);
+      float bIm = 0.5f * (_re[m] - _re[k]);
+      // the bins in between stand for their negative frequencies too
+      float scale = k == 0 || k == half ? _scale : 2 * _scale;
+      powerA[k] = (aRe * aRe + aIm * aIm) * scale;
+      powerB[k] = (bRe * bRe + bIm * bIm) * scale;
+    }
+  }
+  for (std::size_t c = 0; c < emgLength; c++) {
+    features(c, result);
+  }
+}
+
+void EmgSpectrum::fft() {
+  for (std::size_t length = 2; length <= _size; length <<= 1) {
+    std::size_t half = length / 2;
+    std::size_t step = _size / length;
+    for (std::size_t i = 0; i < _size; i += length) {
+      for (std::size_t j = 0; j < half; j++) {
+        // times exp(-2 pi i j / length)
+        float wr = _cos[j * step];
+        float wi = _sin[j * step];
+        std::size_t a = i + j;
+        std::size_t b = a + half;
+        float tr = wr * _re[b] + wi * _im[b];
+        float ti = wr * _im[b] - wi * _re[b];
+        _re[b] = _re[a] - tr;
+        _im[b] = _im[a] - ti;
+        _re[a] += tr;
+        _im[a] += ti;
+      }
+    }
+  }
+}
+
+void EmgSpectrum::features(std::size_t c, Result& result) const {
+  std::size_t half = _size / 2;
+  const float* power = &_power[c * (half + 1)];
+  float binWidth = static_cast<float>(emgRate) / _size;
+  float* bands = &result.bandPower[c * numEmgBands];
+  std::fill(bands, bands + numEmgBands, 0.0f);
+  float total = 0;
+  float weighted = 0;
+  for (std::size_t k = 0; k <= half; k++) {
+    total += power[k];
+    weighted += k * power[k];
+    bands[std::min(k * numEmgBands / half, numEmgBands - 1)] += power[k];
+  }
+  result.meanFrequency[c] = total > 0 ? weighted / total * binWidth : 0;
+  // where half the power lies below, interpolated within its bin
+  float median = 0;
+  float cumulative = 0;
+  for (std::size_t k = 0; k <= half && total > 0; k++) {
+    if (power[k] > 0 && cumulative + power[k] >= total / 2) {
+      median = (k - 0.5f + (total / 2 - cumulative) / power[k]) * binWidth;
+      break;
+    }
+    cumulative += power[k];
+  }
+  result.medianFrequency[c] = std::max(median, 0.0f);
+}
@@ -0,0 +1,132 @@
+//
+//  EmgSpectrum.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Common.h"
+#include "EventRecord.h"
+#include "RingBuffer.h"
+
+// Band power and mean and median frequency of each EMG channel, over a
+// sliding window of frames, from a Hann windowed FFT. The FFTs run on a
+// worker thread of their own: frames come in through one lock-free queue
+// and results go out through another, so the Myo event thread never waits
+// for them, and the thread that sends messages only encodes the results.
+class EmgSpectrum {
+public:
+  struct Result {
+    std::uint32_t deviceId;
+    std::int8_t arm;
+    // of the last frame of the window
+    std::uint64_t timestamp;
+    const DeviceDataPaths* paths;
+    // Mean square of the signal in each band, by channel and then band, in
+    // EMG units squared. The bands of a channel add up to its mean square
+    // over the window, less its mean.
+    float bandPower[emgLength * numEmgBands];
+    // in Hz
+    float meanFrequency[emgLength];
+    float medianFrequency[emgLength];
+  };
+
+  // Analyzes a window of frames (a power of two, within the limits in
+  // Settings) every `every` frames of a device. ready is called on the
+  // worker thread when it has queued results.
+  EmgSpectrum(std::size_t window, std::size_t every, std::function<void()> ready);
+  ~EmgSpectrum();
+
+  EmgSpectrum(const EmgSpectrum&) = delete;
+  EmgSpectrum& operator=(const EmgSpectrum&) = delete;
+
+  // Stops the worker once it has analyzed the frames queued so far. Their
+  // results can still be taken.
+  void stop();
+
+  // Queues an EMG frame, or the disconnect of a device, which starts its
+  // window over. Never blocks; call it from one thread only.
+  void push(const EventRecord& record);
+
+  // Takes the next result. Call it from one thread only.
+  bool pop(Result& result) { return _results.pop(result); }
+
+  bool hasResults() const { return !_results.empty(); }
+
+  // Frames and results dropped because the worker or the sender fell
+  // behind.
+  std::uint64_t framesDropped() const { return _frames.overflows(); }
+  std::uint64_t resultsDropped() const { return _results.overflows(); }
+
+  // Fills in the features of a window of frames, a ring of the window
+  // length starting at the oldest. Used by the worker thread; public for
+  // the benchmarks, on an instance that isn't fed frames.
+  void analyze(const EmgArray* frames, std::size_t oldest, Result& result);
+
+private:
+  static const std::size_t frameQueueSize = 4096;
+  static const std::size_t resultQueueSize = 256;
+
+  struct Frame {
+    const DeviceDataPaths* paths;
+    std::uint64_t timestamp;
+    std::uint32_t deviceId;
+    std::int8_t arm;
+    bool disconnect;
+    EmgArray emg;
+  };
+
+  // the frames of one device, in a ring
+  struct DeviceWindow {
+    std::vector<EmgArray> frames;
+    std::size_t next;
+    std::size_t count;
+    std::size_t untilDue;
+  };
+
+  // Worker thread main loop.
+  void run();
+
+  // Adds a frame to the window of its device, and queues a result when one
+  // is due. Returns whether it did.
+  bool add(const Frame& frame);
+
+  // In place radix-2 FFT of _re and _im, whose inputs are in bit reversed
+  // order.
+  void fft();
+
+  // Band power, mean and median frequency of channel c from _power.
+  void features(std::size_t c, Result& result) const;
+
+  std::size_t _size;
+  std::size_t _every;
+  std::function<void()> _ready;
+  std::vector<float> _window;
+  float _scale;
+  std::vector<std::size_t> _bitReversed;
+  std::vector<float> _cos;
+  std::vector<float> _sin;
+  // scratch, used by analyze()
+  std::vector<float> _re;
+  std::vector<float> _im;
+  // one sided power spectra, size / 2 + 1 bins for each channel
+  std::vector<float> _power;
+  // indexed by device id, used by the worker thread
+  std::vector<DeviceWindow> _devices;
+  RingBuffer<Frame, frameQueueSize> _frames;
+  RingBuffer<Result, resultQueueSize> _results;
+  std::thread _thread;
+  std::atomic<bool> _running;
+  // the worker sleeps while the frame queue is empty
+  std::atomic<bool> _sleeping;
+  std::mutex _wakeMutex;
+  std::condition_variable _wake;
+};
@@ -0,0 +1,149 @@
+//
+//  Euler.cpp
+//  MyoOsc2
+//
+
+#include "Euler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+static const float halfPi = 1.57079632679f;
+static const float pi = 3.14159265359f;
+
+// atan(a) for a in [0, 1], a minimax polynomial in a^2. For floats and
+// vectors of them alike.
+template<typename T>
+static inline T atanUnit(T a) {
+  T s = a * a;
+  T p = -0.0117212f * s + 0.05265332f;
+  p = p * s - 0.11643287f;
+  p = p * s + 0.19354346f;
+  p = p * s - 0.33262347f;
+  p = p * s + 0.99997723f;
+  return p * a;
+}
+
+// atan2(y, x) from atanUnit() of the smaller of |x| and |y| over the
+// larger, moved to the right octant.
+static inline float fastAtan2(float y, float x) {
+  float ax = std::fabs(x);
+  float ay = std::fabs(y);
+  float largest = std::max(ax, ay);
+  float r = atanUnit(std::min(ax, ay) / (largest > 0 ? largest : 1.0f));
+  r = ay > ax ? halfPi - r : r;
+  r = x < 0 ? pi - r : r;
+  return y < 0 ? -r : r;
+}
+
+static inline float fastAsin(float v) {
+  v = std::min(1.0f, std::max(-1.0f, v));
+  return fastAtan2(v, std::sqrt(1.0f - v * v));
+}
+
+static inline void fastEuler(const float* q, float* euler) {
+  float x = q[0], y = q[1], z = q[2], w = q[3];
+  euler[0] = fastAtan2(2.0f * (w * z + x * y), 1.0f - 2.0f * (y * y + z * z));
+  euler[1] = fastAsin(2.0f * (w * y - z * x));
+  euler[2] = fastAtan2(2.0f * (w * x + y * z), 1.0f - 2.0f * (x * x + y * y));
+}
+
+#if defined(__GNUC__)
+// Four quaternions at a time in the vector extensions of GCC and Clang,
+// which become SSE or NEON instructions. Selects are bit masks, since
+// compilers won't turn the branches of the scalar version into selects
+// while floating point comparisons may trap.
+typedef float Floats __attribute__((vector_size(16)));
+typedef std::int32_t Mask __attribute__((vector_size(16)));
+
+static inline Floats select(Mask mask, Floats a, Floats b) {
+  return (Floats)((mask & (Mask)a) | (~mask & (Mask)b));
+}
+
+static inline Floats absolute(Floats v) {
+  return (Floats)((Mask)v & 0x7fffffff);
+}
+
+static inline Floats squareRoot(Floats v) {
+#if defined(__SSE__)
+  return (Floats)_mm_sqrt_ps((__m128)v);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  return (Floats)vsqrtq_f32((float32x4_t)v);
+#else
+  for (int i = 0; i < 4; i++) {
+    v[i] = std::sqrt(v[i]);
+  }
+  return v;
+#endif
+}
+
+static inline Floats fastAtan2(Floats y, Floats x) {
+  Floats ax = absolute(x);
+  Floats ay = absolute(y);
+  Mask steep = ay > ax;
+  Floats largest = select(steep, ay, ax);
+  Floats smallest = select(steep, ax, ay);
+  Floats one = {1, 1, 1, 1};
+  Floats r = atanUnit(smallest / select(largest > 0, largest, one));
+  r = select(steep, halfPi - r, r);
+  r = select(x < 0, pi - r, r);
+  // r is positive, so this gives it the sign of y
+  return (Floats)((Mask)r | ((Mask)y & ~0x7fffffff));
+}
+
+static inline Floats fastAsin(Floats v) {
+  Floats one = {1, 1, 1, 1};
+  v = select(v > one, one, select(v < -one, -one, v));
+  return fastAtan2(v, squareRoot(one - v * v));
+}
+
+static inline void fastEuler4(const float* q, float* euler) {
+  Floats x = {q[0], q[4], q[8], q[12]};
+  Floats y = {q[1], q[5], q[9], q[13]};
+  Floats z = {q[2], q[6], q[10], q[14]};
+  Floats w = {q[3], q[7], q[11], q[15]};
+  Floats yaw = fastAtan2(2.0f * (w * z + x * y), 1.0f - 2.0f * (y * y + z * z));
+  Floats pitch = fastAsin(2.0f * (w * y - z * x));
+  Floats roll = fastAtan2(2.0f * (w * x + y * z), 1.0f - 2.0f * (x * x + y * y));
+  for (int i = 0; i < 4; i++) {
+    euler[3 * i] = yaw[i];
+    euler[3 * i + 1] = pitch[i];
+    euler[3 * i + 2] = roll[i];
+  }
+}
+#endif
+
+void quaternionsToEuler(const float* quats, float* euler, std::size_t count,
+                        EulerPrecision precision) {
+  std::size_t i = 0;
+  if (precision == EulerPrecision::exact) {
+    for (; i < count; i++) {
+      const float* q = quats + 4 * i;
+      float x = q[0], y = q[1], z = q[2], w = q[3];
+      // float arguments, double functions, as the angles were always
+      // computed, so that the output doesn't change
+      double yawY = 2.0f * (w * z + x * y);
+      double yawX = 1.0f - 2.0f * (y * y + z * z);
+      double pitch = 2.0f * (w * y - z * x);
+      double rollY = 2.0f * (w * x + y * z);
+      double rollX = 1.0f - 2.0f * (x * x + y * y);
+      euler[3 * i] = static_cast<float>(std::atan2(yawY, yawX));
+      euler[3 * i + 1] = static_cast<float>(std::asin(pitch));
+      euler[3 * i + 2] = static_cast<float>(std::atan2(rollY, rollX));
+    }
+    return;
+  }
+#if defined(__GNUC__)
+  for (; i + 4 <= count; i += 4) {
+    fastEuler4(quats + 4 * i, euler + 3 * i);
+  }
+#endif
+  for (; i < count; i++) {
+    fastEuler(quats + 4 * i, euler + 3 * i);
+  }
+}
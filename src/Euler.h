@@ -0,0 +1,25 @@
+//
+//  Euler.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <cstddef>
+
+enum class EulerPrecision {
+  // the standard library atan2 and asin in double precision
+  exact,
+  // polynomial approximations, see quaternionsToEuler()
+  fast,
+};
+
+// Converts unit quaternions (x, y, z, w) to Euler angles (yaw, pitch, roll)
+// in radians, count at a time. Fast mode converts four quaternions at a
+// time with SSE or NEON where the compiler supports vector extensions.
+//
+// In fast mode every angle is within 0.0002 degrees of the exact one, and a
+// pitch at the poles is clamped to +-90 degrees where the exact asin gives
+// NaN for a quaternion that is a little off unit length.
+void quaternionsToEuler(const float* quats, float* euler, std::size_t count,
+                        EulerPrecision precision);
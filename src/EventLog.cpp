@@ -0,0 +1,562 @@
+//
+//  EventLog.cpp
+//  MyoOsc2
+//
+
+#include "EventLog.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Log layout, all in host byte order: an 8 byte magic, then one record per
+// event of
+//
+//   uint8   record size, including this header
+//   uint8   EventType
+//   uint16  device index, in the order the devices first appeared
+//   uint64  timestamp
+//   payload, see payloadSize()
+//
+// A record size of 0 marks the end of the log, since a capture that wasn't
+// closed leaves the zero filled rest of its last chunk in the file.
+
+static const char logMagic[8] = {'M', 'y', 'o', 'O', 's', 'c', 'L', '1'};
+static const std::size_t recordHeaderSize = 12;
+// the file grows by this much whenever the mapping is full
+static const std::size_t growSize = 8 << 20;
+
+static std::size_t payloadSize(EventType type) {
+  switch (type) {
+    case EventType::pair:
+    case EventType::connect:
+      return 4 * sizeof(std::uint32_t);
+    case EventType::armSync:
+      return 3 + sizeof(float);
+    case EventType::pose:
+      return sizeof(std::int32_t);
+    case EventType::orientation:
+      return 4 * sizeof(float);
+    case EventType::accelerometer:
+    case EventType::gyroscope:
+      return 3 * sizeof(float);
+    case EventType::rssi:
+    case EventType::batteryLevel:
+    case EventType::warmupCompleted:
+      return 1;
+    case EventType::emg:
+      return emgLength;
+    case EventType::imu:
+      return 10 * sizeof(float);
+    default:
+      return 0;
+  }
+}
+
+template<typename T>
+static void write(char*& out, T value) {
+  std::memcpy(out, &value, sizeof(T));
+  out += sizeof(T);
+}
+
+template<typename T>
+static T read(const char*& in) {
+  T value;
+  std::memcpy(&value, in, sizeof(T));
+  in += sizeof(T);
+  return value;
+}
+
+// Thin wrappers around the file and memory mapping calls of the platform.
+// Each returns false or null on failure, with the reason in lastError().
+#ifdef _WIN32
+
+static const HANDLE noFile = INVALID_HANDLE_VALUE;
+
+static std::string lastError() {
+  return "error " + std::to_string(::GetLastError());
+}
+
+static HANDLE createFile(const std::string& path) {
+  return ::CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                       CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+}
+
+static HANDLE openFile(const std::string& path) {
+  return ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+}
+
+static void closeFile(HANDLE file) {
+  ::CloseHandle(file);
+}
+
+static bool fileSize(HANDLE file, std::size_t& size) {
+  LARGE_INTEGER value;
+  if (!::GetFileSizeEx(file, &value)) {
+    return false;
+  }
+  size = static_cast<std::size_t>(value.QuadPart);
+  return true;
+}
+
+// The file can't be resized while it is mapped.
+static bool resizeFile(HANDLE file, std::size_t size) {
+  LARGE_INTEGER position;
+  position.QuadPart = static_cast<LONGLONG>(size);
+  return ::SetFilePointerEx(file, position, nullptr, FILE_BEGIN) && ::SetEndOfFile(file);
+}
+
+// The view keeps the mapping object alive, so its handle is closed right
+// away.
+static void* mapFile(HANDLE file, std::size_t size, bool writable) {
+  auto size64 = static_cast<std::uint64_t>(size);
+  HANDLE mapping = ::CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                        static_cast<DWORD>(size64 >> 32), static_cast<DWORD>(size64),
+                                        nullptr);
+  if (!mapping) {
+    return nullptr;
+  }
+  void* data = ::MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+  ::CloseHandle(mapping);
+  return data;
+}
+
+static void unmapFile(const void* data, std::size_t) {
+  ::UnmapViewOfFile(data);
+}
+
+#else
+
+static const int noFile = -1;
+
+static std::string lastError() {
+  return std::strerror(errno);
+}
+
+static int createFile(const std::string& path) {
+  return ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+}
+
+static int openFile(const std::string& path) {
+  return ::open(path.c_str(), O_RDONLY);
+}
+
+static void closeFile(int file) {
+  ::close(file);
+}
+
+static bool fileSize(int file, std::size_t& size) {
+  struct stat info;
+  if (::fstat(file, &info) != 0) {
+    return false;
+  }
+  size = static_cast<std::size_t>(info.st_size);
+  return true;
+}
+
+static bool resizeFile(int file, std::size_t size) {
+  return ::ftruncate(file, static_cast<off_t>(size)) == 0;
+}
+
+static void* mapFile(int file, std::size_t size, bool writable) {
+  void* data = writable
+    ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0)
+    : ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+  return data == MAP_FAILED ? nullptr : data;
+}
+
+static void unmapFile(const void* data, std::size_t size) {
+  ::munmap(const_cast<void*>(data), size);
+}
+
+#endif
+
+static std::runtime_error fileError(const char* what, const std::string& path) {
+  return std::runtime_error(std::string(what) + " " + path + ": " + lastError());
+}
+
+EventCapture::EventCapture(const std::string& path)
+: _file(noFile)
+, _data(nullptr)
+, _mapped(0)
+, _used(sizeof(logMagic))
+, _events(0) {
+  _file = createFile(path);
+  if (_file == noFile) {
+    throw fileError("Can't create event log", path);
+  }
+  try {
+    grow(growSize);
+  } catch (...) {
+    closeFile(_file);
+    throw;
+  }
+  std::memcpy(_data, logMagic, sizeof(logMagic));
+}
+
+EventCapture::~EventCapture() {
+  if (_data) {
+    unmapFile(_data, _mapped);
+  }
+  // drop the unused rest of the last chunk; if that fails, the end marker
+  // is still there
+  resizeFile(_file, _used);
+  closeFile(_file);
+}
+
+void EventCapture::grow(std::size_t minSize) {
+  auto size = _mapped;
+  while (size < minSize) {
+    size += growSize;
+  }
+  if (_data) {
+    unmapFile(_data, _mapped);
+    _data = nullptr;
+    _mapped = 0;
+  }
+  if (!resizeFile(_file, size)) {
+    throw std::runtime_error("Can't grow event log: " + lastError());
+  }
+  void* data = mapFile(_file, size, true);
+  if (!data) {
+    throw std::runtime_error("Can't map event log: " + lastError());
+  }
+  _data = static_cast<char*>(data);
+  _mapped = size;
+}
+
+std::uint16_t EventCapture::deviceIndex(MyoPtr device) {
+  for (std::size_t i = 0; i < _devices.size(); i++) {
+    if (_devices[i] == device) {
+      return static_cast<std::uint16_t>(i);
+    }
+  }
+  _devices.push_back(device);
+  return static_cast<std::uint16_t>(_devices.size() - 1);
+}
+
+char* EventCapture::append(EventType type, MyoPtr device, uint64_t timestamp, std::size_t payloadSize) {
+  auto size = recordHeaderSize + payloadSize;
+  if (_used + size > _mapped) {
+    grow(_used + size);
+  }
+  char* out = _data + _used;
+  write(out, static_cast<std::uint8_t>(size));
+  write(out, static_cast<std::uint8_t>(type));
+  write(out, deviceIndex(device));
+  write(out, static_cast<std::uint64_t>(timestamp));
+  _used += size;
+  _events++;
+  return out;
+}
+
+void EventCapture::writeFirmwareVersion(EventType type, MyoPtr device, uint64_t timestamp,
+                                        const myo::FirmwareVersion& version) {
+  char* out = append(type, device, timestamp, payloadSize(type));
+  write(out, static_cast<std::uint32_t>(version.firmwareVersionMajor));
+  write(out, static_cast<std::uint32_t>(version.firmwareVersionMinor));
+  write(out, static_cast<std::uint32_t>(version.firmwareVersionPatch));
+  write(out, static_cast<std::uint32_t>(version.firmwareVersionHardwareRev));
+}
+
+void EventCapture::onPair(MyoPtr device, uint64_t timestamp, myo::FirmwareVersion firmwareVersion) {
+  writeFirmwareVersion(EventType::pair, device, timestamp, firmwareVersion);
+}
+
+void EventCapture::onUnpair(MyoPtr device, uint64_t timestamp) {
+  append(EventType::unpair, device, timestamp, 0);
+}
+
+void EventCapture::onConnect(MyoPtr device, uint64_t timestamp, myo::FirmwareVersion firmwareVersion) {
+  writeFirmwareVersion(EventType::connect, device, timestamp, firmwareVersion);
+}
+
+void EventCapture::onDisconnect(MyoPtr device, uint64_t timestamp) {
+  append(EventType::disconnect, device, timestamp, 0);
+}
+
+void EventCapture::onArmSync(MyoPtr device, uint64_t timestamp, myo::Arm arm, myo::XDirection xDirection,
+                             float rotation, myo::WarmupState warmupState) {
+  char* out = append(EventType::armSync, device, timestamp, payloadSize(EventType::armSync));
+  write(out, static_cast<std::int8_t>(arm));
+  write(out, static_cast<std::int8_t>(xDirection));
+  write(out, static_cast<std::int8_t>(warmupState));
+  write(out, rotation);
+}
+
+void EventCapture::onArmUnsync(MyoPtr device, uint64_t timestamp) {
+  append(EventType::armUnsync, device, timestamp, 0);
+}
+
+void EventCapture::onUnlock(MyoPtr device, uint64_t timestamp) {
+  append(EventType::unlock, device, timestamp, 0);
+}
+
+void EventCapture::onLock(MyoPtr device, uint64_t timestamp) {
+  append(EventType::lock, device, timestamp, 0);
+}
+
+void EventCapture::onPose(MyoPtr device, uint64_t timestamp, myo::Pose pose) {
+  char* out = append(EventType::pose, device, timestamp, payloadSize(EventType::pose));
+  write(out, static_cast<std::int32_t>(pose.type()));
+}
+
+void EventCapture::onOrientationData(MyoPtr device, uint64_t timestamp, const myo::Quaternion<float>& rotation) {
+  char* out = append(EventType::orientation, device, timestamp, payloadSize(EventType::orientation));
+  write(out, rotation.x());
+  write(out, rotation.y());
+  write(out, rotation.z());
+  write(out, rotation.w());
+}
+
+void EventCapture::onImuData(MyoPtr device, uint64_t timestamp, const myo::Quaternion<float>& rotation,
+                             const myo::Vector3<float>& accel, const myo::Vector3<float>& gyro) {
+  char* out = append(EventType::imu, device, timestamp, payloadSize(EventType::imu));
+  write(out, rotation.x());
+  write(out, rotation.y());
+  write(out, rotation.z());
+  write(out, rotation.w());
+  write(out, accel.x());
+  write(out, accel.y());
+  write(out, accel.z());
+  write(out, gyro.x());
+  write(out, gyro.y());
+  write(out, gyro.z());
+}
+
+void EventCapture::onAccelerometerData(MyoPtr device, uint64_t timestamp, const myo::Vector3<float>& accel) {
+  char* out = append(EventType::accelerometer, device, timestamp, payloadSize(EventType::accelerometer));
+  write(out, accel.x());
+  write(out, accel.y());
+  write(out, accel.z());
+}
+
+void EventCapture::onGyroscopeData(MyoPtr device, uint64_t timestamp, const myo::Vector3<float>& gyro) {
+  char* out = append(EventType::gyroscope, device, timestamp, payloadSize(EventType::gyroscope));
+  write(out, gyro.x());
+  write(out, gyro.y());
+  write(out, gyro.z());
+}
+
+void EventCapture::onRssi(MyoPtr device, uint64_t timestamp, int8_t rssi) {
+  char* out = append(EventType::rssi, device, timestamp, payloadSize(EventType::rssi));
+  write(out, rssi);
+}
+
+void EventCapture::onBatteryLevelReceived(MyoPtr device, uint64_t timestamp, uint8_t level) {
+  char* out = append(EventType::batteryLevel, device, timestamp, payloadSize(EventType::batteryLevel));
+  write(out, level);
+}
+
+void EventCapture::onEmgData(MyoPtr device, uint64_t timestamp, const int8_t* emg) {
+  char* out = append(EventType::emg, device, timestamp, payloadSize(EventType::emg));
+  std::memcpy(out, emg, emgLength);
+}
+
+void EventCapture::onWarmupCompleted(MyoPtr device, uint64_t timestamp, myo::WarmupResult warmupResult) {
+  char* out = append(EventType::warmupCompleted, device, timestamp, payloadSize(EventType::warmupCompleted));
+  write(out, static_cast<std::int8_t>(warmupResult));
+}
+
+EventReplay::EventReplay(const std::string& path)
+: _data(nullptr)
+, _mapped(0)
+, _size(0)
+, _position(sizeof(logMagic))
+, _eventCount(0)
+, _start(0)
+, _end(0) {
+  auto file = openFile(path);
+  if (file == noFile) {
+    throw fileError("Can't open event log", path);
+  }
+  if (!fileSize(file, _mapped)) {
+    auto error = fileError("Can't read event log", path);
+    closeFile(file);
+    throw error;
+  }
+  if (_mapped < sizeof(logMagic)) {
+    closeFile(file);
+    throw std::runtime_error("Not an event log: " + path);
+  }
+  void* data = mapFile(file, _mapped, false);
+  if (!data) {
+    auto error = fileError("Can't map event log", path);
+    closeFile(file);
+    throw error;
+  }
+  // the mapping keeps the file open
+  closeFile(file);
+  _data = static_cast<const char*>(data);
+  if (std::memcmp(_data, logMagic, sizeof(logMagic)) != 0) {
+    unmapFile(data, _mapped);
+    throw std::runtime_error("Not an event log: " + path);
+  }
+
+  std::size_t devices = 0;
+  std::size_t position = sizeof(logMagic);
+  std::size_t next;
+  while ((next = nextRecord(position)) != position) {
+    const char* in = _data + position + 2;
+    auto device = read<std::uint16_t>(in);
+    auto timestamp = read<std::uint64_t>(in);
+    if (_eventCount == 0) {
+      _start = timestamp;
+    }
+    _end = timestamp;
+    devices = std::max<std::size_t>(devices, device + 1);
+    _eventCount++;
+    position = next;
+  }
+  _size = position;
+  _handles.assign(devices, 0);
+}
+
+EventReplay::~EventReplay() {
+  unmapFile(_data, _mapped);
+}
+
+// Returns the position after the record at the given position, or the
+// same position at the end of the log or at a damaged record.
+std::size_t EventReplay::nextRecord(std::size_t position) const {
+  if (position + recordHeaderSize > _mapped) {
+    return position;
+  }
+  auto size = static_cast<std::uint8_t>(_data[position]);
+  auto type = static_cast<EventType>(_data[position + 1]);
+  if (size != recordHeaderSize + payloadSize(type)
+      || type > EventType::imu
+      || position + size > _mapped) {
+    return position;
+  }
+  return position + size;
+}
+
+void EventReplay::rewind() {
+  _position = sizeof(logMagic);
+}
+
+std::size_t EventReplay::run(myo::DeviceListener& listener, std::uint64_t until) {
+  std::size_t count = 0;
+  while (_position < _size) {
+    const char* in = _data + _position + 4;
+    auto timestamp = read<std::uint64_t>(in);
+    if (timestamp > _start && timestamp - _start > until) {
+      break;
+    }
+    deliver(listener, _data + _position);
+    _position += static_cast<std::uint8_t>(_data[_position]);
+    count++;
+  }
+  return count;
+}
+
+void EventReplay::deliver(myo::DeviceListener& listener, const char* record) const {
+  const char* in = record + 1;
+  auto type = static_cast<EventType>(read<std::uint8_t>(in));
+  auto device = handle(read<std::uint16_t>(in));
+  auto timestamp = read<std::uint64_t>(in);
+
+  switch (type) {
+    case EventType::pair:
+    case EventType::connect: {
+      myo::FirmwareVersion version;
+      version.firmwareVersionMajor = read<std::uint32_t>(in);
+      version.firmwareVersionMinor = read<std::uint32_t>(in);
+      version.firmwareVersionPatch = read<std::uint32_t>(in);
+      version.firmwareVersionHardwareRev = read<std::uint32_t>(in);
+      if (type == EventType::pair) {
+        listener.onPair(device, timestamp, version);
+      } else {
+        listener.onConnect(device, timestamp, version);
+      }
+      break;
+    }
+    case EventType::unpair:
+      listener.onUnpair(device, timestamp);
+      break;
+    case EventType::disconnect:
+      listener.onDisconnect(device, timestamp);
+      break;
+    case EventType::armSync: {
+      auto arm = static_cast<myo::Arm>(read<std::int8_t>(in));
+      auto xDirection = static_cast<myo::XDirection>(read<std::int8_t>(in));
+      auto warmupState = static_cast<myo::WarmupState>(read<std::int8_t>(in));
+      auto rotation = read<float>(in);
+      listener.onArmSync(device, timestamp, arm, xDirection, rotation, warmupState);
+      break;
+    }
+    case EventType::armUnsync:
+      listener.onArmUnsync(device, timestamp);
+      break;
+    case EventType::unlock:
+      listener.onUnlock(device, timestamp);
+      break;
+    case EventType::lock:
+      listener.onLock(device, timestamp);
+      break;
+    case EventType::pose:
+      listener.onPose(device, timestamp, myo::Pose(static_cast<myo::Pose::Type>(read<std::int32_t>(in))));
+      break;
+    case EventType::orientation: {
+      auto x = read<float>(in);
+      auto y = read<float>(in);
+      auto z = read<float>(in);
+      auto w = read<float>(in);
+      listener.onOrientationData(device, timestamp, myo::Quaternion<float>(x, y, z, w));
+      break;
+    }
+    case EventType::accelerometer:
+    case EventType::gyroscope: {
+      auto x = read<float>(in);
+      auto y = read<float>(in);
+      auto z = read<float>(in);
+      if (type == EventType::accelerometer) {
+        listener.onAccelerometerData(device, timestamp, myo::Vector3<float>(x, y, z));
+      } else {
+        listener.onGyroscopeData(device, timestamp, myo::Vector3<float>(x, y, z));
+      }
+      break;
+    }
+    case EventType::rssi:
+      listener.onRssi(device, timestamp, read<std::int8_t>(in));
+      break;
+    case EventType::batteryLevel:
+      listener.onBatteryLevelReceived(device, timestamp, read<std::uint8_t>(in));
+      break;
+    case EventType::emg: {
+      std::int8_t emg[emgLength];
+      std::memcpy(emg, in, emgLength);
+      listener.onEmgData(device, timestamp, emg);
+      break;
+    }
+    case EventType::warmupCompleted:
+      listener.onWarmupCompleted(device, timestamp,
+                                 static_cast<myo::WarmupResult>(read<std::int8_t>(in)));
+      break;
+    case EventType::imu: {
+      float values[10];
+      for (auto& value : values) {
+        value = read<float>(in);
+      }
+      listener.onImuData(device, timestamp,
+                         myo::Quaternion<float>(values[0], values[1], values[2], values[3]),
+                         myo::Vector3<float>(values[4], values[5], values[6]),
+                         myo::Vector3<float>(values[7], values[8], values[9]));
+      break;
+    }
+    default:
+      break;
+  }
+}
@@ -0,0 +1,127 @@
+//
+//  EventLog.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Common.h"
+#include "EventRecord.h"
+
+// Writes every event it receives to a compact binary log, so that a
+// session can be replayed later with EventReplay. Add it to the Hub before
+// any other listener.
+//
+// The log is written through a memory mapping of the file, so recording an
+// event is a copy into memory; the file only grows (and gets remapped)
+// every few megabytes. Whatever was recorded survives the process being
+// killed, since the mapping is shared with the file. Uses mmap, or file
+// mappings on Windows.
+class EventCapture : public myo::DeviceListener {
+public:
+  // Throws std::runtime_error when the file can't be created.
+  explicit EventCapture(const std::string& path);
+  ~EventCapture();
+
+  EventCapture(const EventCapture&) = delete;
+  EventCapture& operator=(const EventCapture&) = delete;
+
+  std::uint64_t eventCount() const { return _events; }
+
+  void onPair(MyoPtr device, uint64_t timestamp, myo::FirmwareVersion firmwareVersion) override;
+  void onUnpair(MyoPtr device, uint64_t timestamp) override;
+  void onConnect(MyoPtr device, uint64_t timestamp, myo::FirmwareVersion firmwareVersion) override;
+  void onDisconnect(MyoPtr device, uint64_t timestamp) override;
+  void onArmSync(MyoPtr device, uint64_t timestamp, myo::Arm arm, myo::XDirection xDirection, float rotation,
+                 myo::WarmupState warmupState) override;
+  void onArmUnsync(MyoPtr device, uint64_t timestamp) override;
+  void onUnlock(MyoPtr device, uint64_t timestamp) override;
+  void onLock(MyoPtr device, uint64_t timestamp) override;
+  void onPose(MyoPtr device, uint64_t timestamp, myo::Pose pose) override;
+  void onOrientationData(MyoPtr device, uint64_t timestamp, const myo::Quaternion<float>& rotation) override;
+  void onImuData(MyoPtr device, uint64_t timestamp, const myo::Quaternion<float>& rotation,
+                 const myo::Vector3<float>& accel, const myo::Vector3<float>& gyro) override;
+  void onAccelerometerData(MyoPtr device, uint64_t timestamp, const myo::Vector3<float>& accel) override;
+  void onGyroscopeData(MyoPtr device, uint64_t timestamp, const myo::Vector3<float>& gyro) override;
+  void onRssi(MyoPtr device, uint64_t timestamp, int8_t rssi) override;
+  void onBatteryLevelReceived(MyoPtr device, uint64_t timestamp, uint8_t level) override;
+  void onEmgData(MyoPtr device, uint64_t timestamp, const int8_t* emg) override;
+  void onWarmupCompleted(MyoPtr device, uint64_t timestamp, myo::WarmupResult warmupResult) override;
+
+private:
+  // Starts a record and returns where its payload goes.
+  char* append(EventType type, MyoPtr device, uint64_t timestamp, std::size_t payloadSize);
+  void grow(std::size_t minSize);
+  std::uint16_t deviceIndex(MyoPtr device);
+  void writeFirmwareVersion(EventType type, MyoPtr device, uint64_t timestamp,
+                            const myo::FirmwareVersion& version);
+
+#ifdef _WIN32
+  // a HANDLE, without pulling in windows.h
+  using File = void*;
+#else
+  using File = int;
+#endif
+
+  File _file;
+  char* _data;
+  std::size_t _mapped;
+  std::size_t _used;
+  // index in the log of each device seen so far
+  std::vector<MyoPtr> _devices;
+  std::uint64_t _events;
+};
+
+// Feeds a log written by EventCapture to a listener.
+//
+// The Myo objects of the recorded session are gone, so the listener gets
+// opaque handles that must never be dereferenced, one per recorded device.
+// Listeners that call into the Myo on connect have to skip that during a
+// replay.
+class EventReplay {
+public:
+  // Throws std::runtime_error when the file can't be read or isn't a log.
+  explicit EventReplay(const std::string& path);
+  ~EventReplay();
+
+  EventReplay(const EventReplay&) = delete;
+  EventReplay& operator=(const EventReplay&) = delete;
+
+  std::size_t eventCount() const { return _eventCount; }
+  std::size_t deviceCount() const { return _handles.size(); }
+  // Microseconds between the first and the last event.
+  std::uint64_t duration() const { return _end - _start; }
+
+  bool done() const { return _position == _size; }
+
+  // Delivers every event up to and including the given time, in
+  // microseconds after the first event, to the listener. Returns the number
+  // of events.
+  std::size_t run(myo::DeviceListener& listener, std::uint64_t until);
+
+  // Starts over at the first event.
+  void rewind();
+
+private:
+  std::size_t nextRecord(std::size_t position) const;
+  void deliver(myo::DeviceListener& listener, const char* record) const;
+
+  MyoPtr handle(std::size_t device) const {
+    return reinterpret_cast<MyoPtr>(const_cast<char*>(&_handles[device]));
+  }
+
+  const char* _data;
+  std::size_t _mapped;
+  // end of the last record
+  std::size_t _size;
+  std::size_t _position;
+  std::size_t _eventCount;
+  std::uint64_t _start;
+  std::uint64_t _end;
+  // storage that gives each recorded device a distinct address
+  std::vector<char> _handles;
+};
@@ -0,0 +1,77 @@
+//
+//  EventRecord.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <cstdint>
+#include "Common.h"
+
+class DeviceDataPaths;
+
+enum class EventType : std::uint8_t {
+  pair,
+  unpair,
+  connect,
+  disconnect,
+  armSync,
+  armUnsync,
+  unlock,
+  lock,
+  pose,
+  orientation,
+  accelerometer,
+  gyroscope,
+  rssi,
+  batteryLevel,
+  emg,
+  warmupCompleted,
+  // orientation, accelerometer and gyroscope data of one sample
+  imu,
+  // not a Myo event: asks the sender to send its latency percentiles
+  latencyStats,
+};
+
+// A compact, trivially copyable copy of one libmyo callback, queued from
+// the hub thread to the sender thread.
+struct EventRecord {
+  EventType type;
+  // arm the device was synced to when the event arrived (myo::Arm)
+  std::int8_t arm;
+  // the deadband filter kept the sample from being sent, and it is only
+  // queued for the EMG envelope
+  bool suppressed;
+  std::uint32_t deviceId;
+  std::uint64_t timestamp;
+  // steady clock time in nanoseconds when the callback ran, for measuring
+  // the latency until the messages are sent
+  std::uint64_t received;
+  // output paths of the device, owned by DataPaths
+  const DeviceDataPaths* paths;
+  union {
+    float quat[4];
+    float vec[3];
+    struct {
+      float quat[4];
+      float accel[3];
+      float gyro[3];
+      // which of the three to send, one bit per StreamClass
+      std::uint8_t streams;
+    } imu;
+    std::int8_t emg[emgLength];
+    std::int8_t rssi;
+    std::uint8_t battery;
+    std::int8_t warmupResult;
+    struct {
+      std::uint8_t type;
+      bool active;
+    } pose;
+    struct {
+      std::int8_t arm;
+      std::int8_t xDirection;
+      std::int8_t warmupState;
+      float rotation;
+    } armSync;
+  } payload;
+};
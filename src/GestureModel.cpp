@@ -0,0 +1,116 @@
+//
+//  GestureModel.cpp
+//  MyoOsc2
+//
+
+#include "GestureModel.h"
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+GestureModel::GestureModel(std::size_t window, std::size_t every,
+                           std::vector<std::string> classes,
+                           std::vector<float> weights,
+                           std::vector<float> biases)
+: _window(window)
+, _every(every)
+, _classes(std::move(classes))
+, _weights(std::move(weights))
+, _biases(std::move(biases)) {
+  if (_window < 1 || _window > maxWindow || _every < 1 || _every > maxWindow) {
+    throw std::runtime_error("Gesture model window must be 1 to "
+                             + std::to_string(maxWindow) + " frames");
+  }
+  if (_classes.size() < 2 || _classes.size() > maxClasses) {
+    throw std::runtime_error("Gesture model must have 2 to "
+                             + std::to_string(maxClasses) + " classes");
+  }
+  if (_weights.size() != _classes.size() * numFeatures || _biases.size() != _classes.size()) {
+    throw std::runtime_error("Gesture model needs a bias and "
+                             + std::to_string(numFeatures) + " weights per class");
+  }
+}
+
+GestureModel GestureModel::load(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("Can't open gesture model " + path);
+  }
+  return read(in, path);
+}
+
+GestureModel GestureModel::read(std::istream& in, const std::string& name) {
+  std::size_t window = 0;
+  std::size_t every = 0;
+  std::vector<std::string> classes;
+  std::vector<float> weights;
+  std::vector<float> biases;
+  std::string line;
+  for (std::size_t number = 1; std::getline(in, line); number++) {
+    auto error = [&](const std::string& what) {
+      return std::runtime_error(what + " in gesture model " + name + " line " + std::to_string(number));
+    };
+    std::istringstream fields(line);
+    std::string key;
+    if (!(fields >> key) || key[0] == '#') {
+      continue;
+    }
+    if (key == "window" || key == "every") {
+      double frames;
+      if (!(fields >> frames) || frames < 1 || frames != std::floor(frames)) {
+        throw error("Invalid " + key);
+      }
+      (key == "window" ? window : every) = static_cast<std::size_t>(frames);
+    } else if (key == "class") {
+      std::string className;
+      float bias;
+      if (!(fields >> className >> bias)) {
+        throw error("Missing class name or bias");
+      }
+      for (std::size_t i = 0; i < numFeatures; i++) {
+        float weight;
+        if (!(fields >> weight)) {
+          throw error("Expected " + std::to_string(numFeatures) + " weights");
+        }
+        weights.push_back(weight);
+      }
+      classes.push_back(className);
+      biases.push_back(bias);
+    } else {
+      throw error("Unknown key " + key);
+    }
+    std::string rest;
+    if (fields >> rest && rest[0] != '#') {
+      throw error("Unexpected " + rest);
+    }
+  }
+  if (in.bad()) {
+    throw std::runtime_error("Can't read gesture model " + name);
+  }
+  return GestureModel(window, every ? every : window, std::move(classes),
+                      std::move(weights), std::move(biases));
+}
+
+GestureModel::Prediction GestureModel::predict(const float* features) const {
+  std::array<float, maxClasses> scores;
+  std::size_t count = _classes.size();
+  std::size_t best = 0;
+  for (std::size_t c = 0; c < count; c++) {
+    const float* weights = &_weights[c * numFeatures];
+    float score = _biases[c];
+    for (std::size_t i = 0; i < numFeatures; i++) {
+      score += weights[i] * features[i];
+    }
+    scores[c] = score;
+    if (score > scores[best]) {
+      best = c;
+    }
+  }
+  // softmax, relative to the best score so that nothing overflows
+  float sum = 0;
+  for (std::size_t c = 0; c < count; c++) {
+    sum += std::exp(scores[c] - scores[best]);
+  }
+  return {static_cast<std::int32_t>(best), 1 / sum};
+}
@@ -0,0 +1,73 @@
+//
+//  GestureModel.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+#include "Common.h"
+
+// A linear classifier of EMG gestures, such as linear discriminant analysis
+// or logistic regression, over the mean absolute value and RMS of each
+// channel in a window of frames (see EmgEnvelope). The score of a class is
+// its bias plus the dot product of its weights with the features. The
+// gesture is the class with the highest score, and its confidence is the
+// softmax of the scores, which for both kinds of model is the probability
+// of the class.
+//
+// Models are trained offline and loaded from a text file:
+//
+//   # comments and blank lines are ignored
+//   window 40
+//   every 10
+//   class rest <bias> <16 weights>
+//   class fist <bias> <16 weights>
+//
+// window is the number of frames the features are computed over, and every
+// the number of frames between predictions (by default the window). The
+// weights are for the MAV of channels 0 to 7, then their RMS, in EMG units:
+// fold any feature scaling into them. Classes are numbered from 0 in the
+// order of the file.
+class GestureModel {
+public:
+  static const std::size_t numFeatures = 2 * emgLength;
+  static const std::size_t maxClasses = 64;
+  static const std::size_t maxWindow = 1000;
+
+  struct Prediction {
+    std::int32_t gesture;
+    float confidence;
+  };
+
+  // weights by class, then feature
+  GestureModel(std::size_t window, std::size_t every,
+               std::vector<std::string> classes,
+               std::vector<float> weights,
+               std::vector<float> biases);
+
+  // Throws std::runtime_error when the file can't be read or isn't a valid
+  // model.
+  static GestureModel load(const std::string& path);
+  static GestureModel read(std::istream& in, const std::string& name);
+
+  std::size_t window() const { return _window; }
+  std::size_t every() const { return _every; }
+  const std::vector<std::string>& classes() const { return _classes; }
+
+  // Classifies the features: the MAV of each channel, then the RMS. Doesn't
+  // allocate.
+  Prediction predict(const float* features) const;
+
+private:
+  std::size_t _window;
+  std::size_t _every;
+  std::vector<std::string> _classes;
+  std::vector<float> _weights;
+  std::vector<float> _biases;
+};
@@ -0,0 +1,123 @@
+//
+//  LatencyHistogram.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Histogram of durations in nanoseconds, with log-linear buckets in the
+// style of HdrHistogram: values below 64 are counted exactly, and every
+// power of two above that is split into 32 equal buckets, so each bucket
+// is within about 3% of the values counted in it. Recording is constant
+// time and never allocates. Values above about 18 minutes are clamped.
+// Not thread safe.
+class LatencyHistogram {
+public:
+  static const unsigned subBucketBits = 5;
+  static const std::uint64_t subBuckets = 1 << subBucketBits;
+  static const unsigned maxBits = 40;
+  static const std::size_t bucketCount = subBuckets * (maxBits - subBucketBits + 1);
+
+  LatencyHistogram() {
+    reset();
+  }
+
+  void record(std::uint64_t nanoseconds) {
+    _counts[bucketOf(nanoseconds)]++;
+    _count++;
+    if (nanoseconds > _max) {
+      _max = nanoseconds;
+    }
+  }
+
+  std::uint64_t count() const { return _count; }
+  std::uint64_t max() const { return _max; }
+
+  // Value that the given percentage of recorded values is at or below,
+  // rounded up to the end of its bucket.
+  std::uint64_t percentile(double percent) const {
+    if (_count == 0) {
+      return 0;
+    }
+    auto rank = static_cast<std::uint64_t>(percent / 100 * _count + 0.5);
+    if (rank < 1) {
+      rank = 1;
+    }
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < bucketCount; i++) {
+      seen += _counts[i];
+      if (seen >= rank) {
+        auto value = highestValueOf(i);
+        return value < _max ? value : _max;
+      }
+    }
+    return _max;
+  }
+
+  void add(const LatencyHistogram& other) {
+    for (std::size_t i = 0; i < bucketCount; i++) {
+      _counts[i] += other._counts[i];
+    }
+    _count += other._count;
+    if (other._max > _max) {
+      _max = other._max;
+    }
+  }
+
+  void reset() {
+    _counts.fill(0);
+    _count = 0;
+    _max = 0;
+  }
+
+private:
+  static std::size_t bucketOf(std::uint64_t value) {
+    if (value < 2 * subBuckets) {
+      return static_cast<std::size_t>(value);
+    }
+    if (value >> maxBits) {
+      value = (std::uint64_t(1) << maxBits) - 1;
+    }
+    // the top subBucketBits + 1 bits of the value pick the bucket
+    unsigned shift = highestBit(value) - subBucketBits;
+    return static_cast<std::size_t>(shift * subBuckets + (value >> shift));
+  }
+
+  // Index of the highest set bit of a value that isn't 0.
+  static unsigned highestBit(std::uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+#if defined(_M_X64) || defined(_M_ARM64)
+    _BitScanReverse64(&index, value);
+#else
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32))) {
+      return static_cast<unsigned>(index) + 32;
+    }
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+#endif
+    return static_cast<unsigned>(index);
+#else
+    return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+  }
+
+  static std::uint64_t highestValueOf(std::size_t bucket) {
+    if (bucket < 2 * subBuckets) {
+      return bucket;
+    }
+    auto shift = bucket / subBuckets - 1;
+    auto top = bucket % subBuckets + subBuckets;
+    return ((top + 1) << shift) - 1;
+  }
+
+  std::array<std::uint64_t, bucketCount> _counts;
+  std::uint64_t _count;
+  std::uint64_t _max;
+};
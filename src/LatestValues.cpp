@@ -0,0 +1,157 @@
+//
+//  LatestValues.cpp
+//  MyoOsc2
+//
+
+#include "LatestValues.h"
+#include <algorithm>
+#include <new>
+
+static std::size_t roundToCacheLine(std::size_t size) {
+  auto line = LatestValues::cacheLineSize;
+  return (size + line - 1) / line * line;
+}
+
+LatestValues::LatestValues(std::size_t capacity)
+: _capacity(capacity) {
+  std::size_t size = roundToCacheLine(capacity * sizeof(std::atomic<std::uint32_t>))
+    + roundToCacheLine(capacity * sizeof(std::uint8_t))
+    + roundToCacheLine(capacity * sizeof(std::array<float, 4>))
+    + 2 * roundToCacheLine(capacity * sizeof(std::array<float, 3>))
+    + roundToCacheLine(capacity * sizeof(EmgArray))
+    + roundToCacheLine(capacity * sizeof(std::int8_t))
+    + roundToCacheLine(capacity * sizeof(std::uint8_t))
+    + roundToCacheLine(capacity * sizeof(std::array<std::uint64_t, numFields>));
+  // room to move the first column to the start of a cache line
+  _storage.reset(new char[size + cacheLineSize]());
+  auto address = reinterpret_cast<std::uintptr_t>(_storage.get());
+  std::size_t offset = roundToCacheLine(address) - address;
+
+  _sequence = column<std::atomic<std::uint32_t>>(offset);
+  _fields = column<std::uint8_t>(offset);
+  _quat = column<std::array<float, 4>>(offset);
+  _accel = column<std::array<float, 3>>(offset);
+  _gyro = column<std::array<float, 3>>(offset);
+  _emg = column<EmgArray>(offset);
+  _rssi = column<std::int8_t>(offset);
+  _battery = column<std::uint8_t>(offset);
+  _timestamps = column<std::array<std::uint64_t, numFields>>(offset);
+}
+
+template<typename T>
+T* LatestValues::column(std::size_t& offset) {
+  T* values = reinterpret_cast<T*>(_storage.get() + offset);
+  for (std::size_t i = 0; i < _capacity; i++) {
+    new (values + i) T();
+  }
+  offset += roundToCacheLine(_capacity * sizeof(T));
+  return values;
+}
+
+void LatestValues::setOrientation(MyoId id, std::uint64_t timestamp, const float* quat) {
+  if (id >= _capacity) {
+    return;
+  }
+  beginWrite(id);
+  std::copy(quat, quat + 4, _quat[id].begin());
+  stamp(id, Field::orientation, timestamp);
+  endWrite(id);
+}
+
+void LatestValues::setAccel(MyoId id, std::uint64_t timestamp, const float* accel) {
+  if (id >= _capacity) {
+    return;
+  }
+  beginWrite(id);
+  std::copy(accel, accel + 3, _accel[id].begin());
+  stamp(id, Field::accel, timestamp);
+  endWrite(id);
+}
+
+void LatestValues::setGyro(MyoId id, std::uint64_t timestamp, const float* gyro) {
+  if (id >= _capacity) {
+    return;
+  }
+  beginWrite(id);
+  std::copy(gyro, gyro + 3, _gyro[id].begin());
+  stamp(id, Field::gyro, timestamp);
+  endWrite(id);
+}
+
+void LatestValues::setImu(MyoId id, std::uint64_t timestamp,
+                          const float* quat, const float* accel, const float* gyro) {
+  if (id >= _capacity) {
+    return;
+  }
+  beginWrite(id);
+  std::copy(quat, quat + 4, _quat[id].begin());
+  std::copy(accel, accel + 3, _accel[id].begin());
+  std::copy(gyro, gyro + 3, _gyro[id].begin());
+  stamp(id, Field::orientation, timestamp);
+  stamp(id, Field::accel, timestamp);
+  stamp(id, Field::gyro, timestamp);
+  endWrite(id);
+}
+
+void LatestValues::setEmg(MyoId id, std::uint64_t timestamp, const std::int8_t* emg) {
+  if (id >= _capacity) {
+    return;
+  }
+  beginWrite(id);
+  std::copy(emg, emg + emgLength, _emg[id].begin());
+  stamp(id, Field::emg, timestamp);
+  endWrite(id);
+}
+
+void LatestValues::setRssi(MyoId id, std::uint64_t timestamp, std::int8_t rssi) {
+  if (id >= _capacity) {
+    return;
+  }
+  beginWrite(id);
+  _rssi[id] = rssi;
+  stamp(id, Field::rssi, timestamp);
+  endWrite(id);
+}
+
+void LatestValues::setBattery(MyoId id, std::uint64_t timestamp, std::uint8_t level) {
+  if (id >= _capacity) {
+    return;
+  }
+  beginWrite(id);
+  _battery[id] = level;
+  stamp(id, Field::battery, timestamp);
+  endWrite(id);
+}
+
+void LatestValues::clear(MyoId id) {
+  if (id >= _capacity) {
+    return;
+  }
+  beginWrite(id);
+  _fields[id] = 0;
+  endWrite(id);
+}
+
+bool LatestValues::snapshot(MyoId id, Snapshot& snapshot) const {
+  if (id >= _capacity) {
+    return false;
+  }
+  for (;;) {
+    auto before = _sequence[id].load(std::memory_order_acquire);
+    if (before & 1) {
+      continue;
+    }
+    snapshot.fields = _fields[id];
+    snapshot.quat = _quat[id];
+    snapshot.accel = _accel[id];
+    snapshot.gyro = _gyro[id];
+    snapshot.emg = _emg[id];
+    snapshot.rssi = _rssi[id];
+    snapshot.battery = _battery[id];
+    snapshot.timestamps = _timestamps[id];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (_sequence[id].load(std::memory_order_relaxed) == before) {
+      return true;
+    }
+  }
+}
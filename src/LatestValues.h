@@ -0,0 +1,123 @@
+//
+//  LatestValues.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "Common.h"
+
+// The latest sensor values of every device, indexed by device id, for
+// whatever needs the current state rather than the stream of samples.
+//
+// The values are stored as a struct of arrays, one column per value, each
+// column starting on its own cache line, so that reading one value for all
+// devices touches as few lines as possible. The Myo event thread updates
+// them in place. Readers on any other thread take consistent snapshots
+// without locks: every device has a sequence counter that is odd while
+// its values are being written, and a reader retries until it has copied
+// the values between two equal, even readings of it.
+class LatestValues {
+public:
+  enum class Field : std::uint8_t {
+    orientation,
+    accel,
+    gyro,
+    emg,
+    rssi,
+    battery,
+  };
+
+  static const std::size_t numFields = 6;
+  static const std::size_t defaultCapacity = 256;
+  static const std::size_t cacheLineSize = 64;
+
+  struct Snapshot {
+    // bit per Field, set for the values received since the device connected
+    std::uint8_t fields;
+    std::array<float, 4> quat;
+    std::array<float, 3> accel;
+    std::array<float, 3> gyro;
+    EmgArray emg;
+    std::int8_t rssi;
+    std::uint8_t battery;
+    // Myo timestamp of each value, indexed by Field
+    std::array<std::uint64_t, numFields> timestamps;
+
+    bool has(Field field) const {
+      return fields & bit(field);
+    }
+  };
+
+  // Devices with an id at or above the capacity aren't stored.
+  explicit LatestValues(std::size_t capacity = defaultCapacity);
+
+  LatestValues(const LatestValues&) = delete;
+  LatestValues& operator=(const LatestValues&) = delete;
+
+  std::size_t capacity() const { return _capacity; }
+
+  // Only to be called from the Myo event thread.
+  void setOrientation(MyoId id, std::uint64_t timestamp, const float* quat);
+  void setAccel(MyoId id, std::uint64_t timestamp, const float* accel);
+  void setGyro(MyoId id, std::uint64_t timestamp, const float* gyro);
+  void setImu(MyoId id, std::uint64_t timestamp,
+              const float* quat, const float* accel, const float* gyro);
+  void setEmg(MyoId id, std::uint64_t timestamp, const std::int8_t* emg);
+  void setRssi(MyoId id, std::uint64_t timestamp, std::int8_t rssi);
+  void setBattery(MyoId id, std::uint64_t timestamp, std::uint8_t level);
+  // Forgets the values of a device, when it disconnects.
+  void clear(MyoId id);
+
+  // Copies the values of a device. Safe from any thread. Returns false for
+  // ids beyond the capacity.
+  bool snapshot(MyoId id, Snapshot& snapshot) const;
+
+  // Changes whenever the values of the device do, so a reader can tell
+  // whether a new snapshot is needed. Safe from any thread.
+  std::uint32_t sequence(MyoId id) const {
+    return id < _capacity ? _sequence[id].load(std::memory_order_acquire) : 0;
+  }
+
+private:
+  static std::uint8_t bit(Field field) {
+    return static_cast<std::uint8_t>(1 << static_cast<unsigned>(field));
+  }
+
+  // Brackets the writes to the values of a device.
+  void beginWrite(MyoId id) {
+    auto sequence = _sequence[id].load(std::memory_order_relaxed);
+    _sequence[id].store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
+  void endWrite(MyoId id) {
+    auto sequence = _sequence[id].load(std::memory_order_relaxed);
+    _sequence[id].store(sequence + 1, std::memory_order_release);
+  }
+
+  void stamp(MyoId id, Field field, std::uint64_t timestamp) {
+    _fields[id] |= bit(field);
+    _timestamps[id][static_cast<std::size_t>(field)] = timestamp;
+  }
+
+  // Takes the next column of count elements from the storage.
+  template<typename T>
+  T* column(std::size_t& offset);
+
+  std::size_t _capacity;
+  std::unique_ptr<char[]> _storage;
+  std::atomic<std::uint32_t>* _sequence;
+  std::uint8_t* _fields;
+  std::array<float, 4>* _quat;
+  std::array<float, 3>* _accel;
+  std::array<float, 3>* _gyro;
+  EmgArray* _emg;
+  std::int8_t* _rssi;
+  std::uint8_t* _battery;
+  std::array<std::uint64_t, numFields>* _timestamps;
+};
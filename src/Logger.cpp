@@ -1,70 +1,318 @@
 #include "Logger.h"
+#include <algorithm>
 #include <iomanip>
+#include "Trace.h"
 
-std::ostream& Logger::log() {
-  if (!_settings.logging) {
-    return _nullStream;
+Logger::Logger(const Settings& settings, std::ostream& out)
+: _settings(settings)
+, _out(out)
+, _queued(0)
+, _written(0)
+, _droppedReported(0)
+, _running(false)
+, _sleeping(false) {
+  if (_settings.verbose) {
+    _running = true;
+    _thread = std::thread(&Logger::run, this);
   }
-  return std::cout;
 }
 
-std::ostream& Logger::verbose() {
-  if (!_settings.verbose) {
-    return _nullStream;
+Logger::~Logger() {
+  if (_thread.joinable()) {
+    _running = false;
+    {
+      std::lock_guard<std::mutex> lock(_wakeMutex);
+      _wake.notify_one();
+    }
+    _thread.join();
   }
-  return std::cout;
 }
 
-std::ostream& Logger::verboseMessage(const std::string& path) {
-  if (!_settings.verbose) {
-    return _nullStream;
+Logger::Line::~Line() {
+  if (_logger) {
+    _logger->writeOut(_text.str());
+  }
+}
+
+Logger::Line Logger::log() {
+  return Line(_settings.logging ? this : nullptr);
+}
+
+Logger::Line Logger::verbose() {
+  return Line(_settings.verbose ? this : nullptr);
+}
+
+void Logger::writeOut(const std::string& text) {
+  std::lock_guard<std::mutex> lock(_outMutex);
+  _out << text << std::flush;
+}
+
+void Logger::push(const Record& record) {
+  if (!_records.push(record)) {
+    return;
+  }
+  _queued++;
+  // pairs with the fence in run(): either the background thread sees the
+  // new record before going to sleep, or we see that it is sleeping
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (_sleeping.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(_wakeMutex);
+    _wake.notify_one();
   }
-  return std::cout << std::setw(20) << std::setfill(' ') << std::left << (path + ':');
 }
 
 void Logger::verboseMessage(const std::string& path, float val) {
-  verboseMessage(path) << "  " << std::right << std::setprecision(2) << val << '\n';
+  if (!_settings.verbose) {
+    return;
+  }
+  Record record;
+  record.kind = Record::Kind::floatValue;
+  record.path.address = &path;
+  record.values.floats[0] = val;
+  push(record);
 }
 
 void Logger::verboseMessage(const std::string& path, std::int8_t val) {
-  verboseMessage(path) << "  " << std::setw(10) << std::right << val << '\n';
+  if (!_settings.verbose) {
+    return;
+  }
+  Record record;
+  record.kind = Record::Kind::int8Value;
+  record.path.address = &path;
+  record.values.int8s[0] = val;
+  push(record);
 }
 
 void Logger::verboseMessage(const std::string& path, std::uint8_t val) {
-  verboseMessage(path) << "  " << std::setw(10) << std::right << val << '\n';
+  if (!_settings.verbose) {
+    return;
+  }
+  Record record;
+  record.kind = Record::Kind::uint8Value;
+  record.path.address = &path;
+  record.values.uint8 = val;
+  push(record);
 }
 
 void Logger::verboseMessage(const std::string& path, bool val) {
-  verboseMessage(path) << "  " << std::boolalpha << std::right << val << '\n';
+  if (!_settings.verbose) {
+    return;
+  }
+  Record record;
+  record.kind = Record::Kind::boolValue;
+  record.path.address = &path;
+  record.values.boolean = val;
+  push(record);
 }
 
-void Logger::verboseMessage(const std::array<std::string, 3>& path,
+void Logger::verboseMessage(const VectorDataPaths<3>& path,
                             const myo::Vector3<float>& val) {
   if (!_settings.verbose) {
     return;
   }
-  verboseMessage(path[0], val.x());
-  verboseMessage(path[1], val.y());
-  verboseMessage(path[2], val.z());
+  Record record;
+  record.kind = Record::Kind::vector3;
+  record.path.vector3 = &path;
+  record.values.floats[0] = val.x();
+  record.values.floats[1] = val.y();
+  record.values.floats[2] = val.z();
+  push(record);
 }
 
-void Logger::verboseMessage(const std::array<std::string, 4> &path,
+void Logger::verboseMessage(const VectorDataPaths<4> &path,
                             const myo::Quaternion<float> &val) {
   if (!_settings.verbose) {
     return;
   }
-  verboseMessage(path[0], val.x());
-  verboseMessage(path[1], val.y());
-  verboseMessage(path[2], val.z());
-  verboseMessage(path[3], val.w());
+  Record record;
+  record.kind = Record::Kind::quaternion;
+  record.path.quaternion = &path;
+  record.values.floats[0] = val.x();
+  record.values.floats[1] = val.y();
+  record.values.floats[2] = val.z();
+  record.values.floats[3] = val.w();
+  push(record);
 }
 
-void Logger::verboseMessage(const std::array<std::string, emgLength> &path,
+void Logger::verboseMessage(const VectorDataPaths<emgLength> &path,
                             const std::int8_t *vals) {
   if (!_settings.verbose) {
     return;
   }
-  for (auto i = 0; i < emgLength; i++) {
-    verboseMessage(path[i], vals[i]);
+  Record record;
+  record.kind = Record::Kind::emg;
+  record.path.emg = &path;
+  std::copy(vals, vals + emgLength, record.values.int8s);
+  push(record);
+}
+
+void Logger::verboseEmgFrame(const std::string& path, const std::int8_t* vals) {
+  if (!_settings.verbose) {
+    return;
+  }
+  Record record;
+  record.kind = Record::Kind::emgFrame;
+  record.path.address = &path;
+  std::copy(vals, vals + emgLength, record.values.int8s);
+  push(record);
+}
+
+void Logger::verboseEmgBatch(const std::string& path, std::size_t frames, std::int32_t period) {
+  if (!_settings.verbose) {
+    return;
+  }
+  Record record;
+  record.kind = Record::Kind::emgBatch;
+  record.path.address = &path;
+  record.values.batch.frames = static_cast<std::int32_t>(frames);
+  record.values.batch.period = period;
+  push(record);
+}
+
+void Logger::verboseGesture(const std::string& path, std::int32_t gesture, float confidence) {
+  if (!_settings.verbose) {
+    return;
+  }
+  Record record;
+  record.kind = Record::Kind::gesture;
+  record.path.address = &path;
+  record.values.gesture.id = gesture;
+  record.values.gesture.confidence = confidence;
+  push(record);
+}
+
+void Logger::flush() {
+  if (!_thread.joinable()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(_wakeMutex);
+  _flushed.wait(lock, [this] { return _written == _queued; });
+}
+
+void Logger::run() {
+  Trace::nameThread("logger");
+  Record record;
+  while (true) {
+    // checked before draining, so that nothing queued before the stop is
+    // left behind
+    bool running = _running;
+    std::uint64_t count = 0;
+    std::uint64_t start = Trace::enabled() ? Trace::now() : 0;
+    while (_records.pop(record)) {
+      write(record);
+      count++;
+    }
+    auto dropped = _records.overflows();
+    if (dropped != _droppedReported) {
+      _lines << "Verbose log dropped " << std::dec << dropped - _droppedReported << " messages\n";
+      _droppedReported = dropped;
+    }
+    // whole lines at once, so that other output only comes in between
+    if (_lines.tellp() > 0) {
+      writeOut(_lines.str());
+      _lines.str("");
+    }
+    if (count > 0) {
+      {
+        std::lock_guard<std::mutex> lock(_wakeMutex);
+        _written += count;
+      }
+      _flushed.notify_all();
+    }
+    if (start != 0 && count > 0) {
+      Trace::span("verbose", start, Trace::now());
+    }
+    if (!running) {
+      break;
+    }
+    std::unique_lock<std::mutex> lock(_wakeMutex);
+    _sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_records.empty() && _running) {
+      _wake.wait(lock);
+    }
+    _sleeping.store(false, std::memory_order_relaxed);
+  }
+}
+
+std::ostream& Logger::writePath(const std::string& path) {
+  return _lines << std::setw(20) << std::setfill(' ') << std::left << (path + ':');
+}
+
+void Logger::writeValue(const std::string& path, float val) {
+  writePath(path) << "  " << std::right << std::setprecision(2) << val << '\n';
+}
+
+void Logger::writeValue(const std::string& path, std::int8_t val) {
+  writePath(path) << "  " << std::setw(10) << std::right << val << '\n';
+}
+
+void Logger::write(const Record& record) {
+  const auto& values = record.values;
+  bool vectors = _settings.schema == PathSchema::vectors;
+  switch (record.kind) {
+    case Record::Kind::floatValue:
+      writeValue(*record.path.address, values.floats[0]);
+      break;
+    case Record::Kind::int8Value:
+      writeValue(*record.path.address, values.int8s[0]);
+      break;
+    case Record::Kind::uint8Value:
+      writePath(*record.path.address) << "  " << std::setw(10) << std::right << values.uint8 << '\n';
+      break;
+    case Record::Kind::boolValue:
+      writePath(*record.path.address) << "  " << std::boolalpha << std::right << values.boolean << '\n';
+      break;
+    case Record::Kind::vector3: {
+      const auto& path = *record.path.vector3;
+      if (vectors) {
+        myo::Vector3<float> vec(values.floats[0], values.floats[1], values.floats[2]);
+        writePath(path.vector.address()) << "  " << std::setprecision(2) << vec << '\n';
+        break;
+      }
+      for (std::size_t i = 0; i < 3; i++) {
+        writeValue(path[i].address(), values.floats[i]);
+      }
+      break;
+    }
+    case Record::Kind::quaternion: {
+      const auto& path = *record.path.quaternion;
+      if (vectors) {
+        myo::Quaternion<float> quat(values.floats[0], values.floats[1], values.floats[2], values.floats[3]);
+        writePath(path.vector.address()) << "  " << std::setprecision(2) << quat << '\n';
+        break;
+      }
+      for (std::size_t i = 0; i < 4; i++) {
+        writeValue(path[i].address(), values.floats[i]);
+      }
+      break;
+    }
+    case Record::Kind::emg: {
+      const auto& path = *record.path.emg;
+      if (vectors) {
+        EmgArray emg;
+        std::copy(values.int8s, values.int8s + emgLength, emg.begin());
+        writePath(path.vector.address()) << "  " << emg << '\n';
+        break;
+      }
+      for (std::size_t i = 0; i < emgLength; i++) {
+        writeValue(path[i].address(), values.int8s[i]);
+      }
+      break;
+    }
+    case Record::Kind::emgFrame: {
+      EmgArray emg;
+      std::copy(values.int8s, values.int8s + emgLength, emg.begin());
+      writePath(*record.path.address) << "  " << emg << '\n';
+      break;
+    }
+    case Record::Kind::emgBatch:
+      writePath(*record.path.address) << "  " << std::dec << values.batch.frames << " frames, "
+                                      << values.batch.period << " us apart\n";
+      break;
+    case Record::Kind::gesture:
+      writePath(*record.path.address) << "  " << std::dec << values.gesture.id << " ("
+                                      << std::setprecision(2) << values.gesture.confidence << ")\n";
+      break;
   }
 }
@@ -1,20 +1,75 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <iostream>
+#include <mutex>
 #include <myo.hpp>
-#include "NullOStream.h"
+#include <sstream>
+#include <string>
+#include <thread>
 #include "Common.h"
+#include "DataPaths.h"
+#include "RingBuffer.h"
 #include "Settings.h"
 
+// Writes log lines to standard output, or another stream.
+//
+// log() and verbose() can be used from any thread: each returns a line that
+// is written as a whole when it goes out of scope.
+//
+// Verbose message logging runs for every value sent, so the verboseMessage()
+// calls only queue a small record that refers to the message paths, and a
+// background thread formats and writes it. They must all be made from one
+// thread at a time, the one that sends messages, and the paths must outlive
+// the records: call flush() before they go away. When the queue is full,
+// records are dropped and counted.
 class Logger {
 public:
-  explicit Logger(const Settings& settings) : _settings(settings) {}
+  explicit Logger(const Settings& settings, std::ostream& out = std::cout);
+  ~Logger();
 
-  std::ostream& log();
-  std::ostream& verbose();
+  Logger(const Logger&) = delete;
+  Logger& operator=(const Logger&) = delete;
 
-  std::ostream& verboseMessage(const std::string& path);
+  // A line of the log, collected and then written at once.
+  class Line {
+  public:
+    // Discards what it is given when logger is null.
+    explicit Line(Logger* logger) : _logger(logger) {}
+    Line(Line&& other) : _logger(other._logger), _text(std::move(other._text)) {
+      other._logger = nullptr;
+    }
+    ~Line();
+
+    Line(const Line&) = delete;
+    Line& operator=(const Line&) = delete;
+
+    template<typename T>
+    Line& operator<<(const T& value) {
+      if (_logger) {
+        _text << value;
+      }
+      return *this;
+    }
+
+    // std::endl and std::flush
+    Line& operator<<(std::ostream& (*manipulator)(std::ostream&)) {
+      if (_logger) {
+        manipulator(_text);
+      }
+      return *this;
+    }
+
+  private:
+    Logger* _logger;
+    std::ostringstream _text;
+  };
+
+  Line log();
+  Line verbose();
 
   void verboseMessage(const std::string& path, float val);
 
@@ -24,15 +79,111 @@ public:
 
   void verboseMessage(const std::string& path, bool val);
 
-  void verboseMessage(const std::array<std::string, 3>& path,
+  void verboseMessage(const VectorDataPaths<3>& path,
                       const myo::Vector3<float>& val);
 
-  void verboseMessage(const std::array<std::string, 4>& path,
+  void verboseMessage(const VectorDataPaths<4>& path,
                       const myo::Quaternion<float>& val);
 
-  void verboseMessage(const std::array<std::string, emgLength>& path,
+  void verboseMessage(const VectorDataPaths<emgLength>& path,
                       const std::int8_t* vals);
+
+  // Per channel EMG features, logged as one value each.
+  template<std::size_t N>
+  void verboseMessage(const VectorDataPaths<N>& path, const float* vals) {
+    if (!_settings.verbose) {
+      return;
+    }
+    for (std::size_t i = 0; i < N; i++) {
+      verboseMessage(path[i].address(), vals[i]);
+    }
+  }
+
+  // An EMG frame sent as a single message.
+  void verboseEmgFrame(const std::string& path, const std::int8_t* vals);
+
+  // A batch of EMG frames, with the average period between them.
+  void verboseEmgBatch(const std::string& path, std::size_t frames, std::int32_t period);
+
+  // A gesture class with its confidence.
+  void verboseGesture(const std::string& path, std::int32_t gesture, float confidence);
+
+  // Waits until every verbose message logged so far has been written.
+  void flush();
+
+  // Number of verbose messages dropped because the queue was full.
+  std::uint64_t verboseDropped() const { return _records.overflows(); }
+
 private:
+  static const std::size_t recordQueueSize = 8192;
+
+  struct Record {
+    enum class Kind : std::uint8_t {
+      floatValue,
+      int8Value,
+      uint8Value,
+      boolValue,
+      vector3,
+      quaternion,
+      emg,
+      emgFrame,
+      emgBatch,
+      gesture,
+    };
+
+    Kind kind;
+    union {
+      const std::string* address;
+      const VectorDataPaths<3>* vector3;
+      const VectorDataPaths<4>* quaternion;
+      const VectorDataPaths<emgLength>* emg;
+    } path;
+    union {
+      float floats[4];
+      std::int8_t int8s[emgLength];
+      std::uint8_t uint8;
+      bool boolean;
+      struct {
+        std::int32_t frames;
+        std::int32_t period;
+      } batch;
+      struct {
+        std::int32_t id;
+        float confidence;
+      } gesture;
+    } values;
+  };
+
+  void push(const Record& record);
+
+  // Background thread main loop.
+  void run();
+
+  // Writes to the output stream, from any thread.
+  void writeOut(const std::string& text);
+
+  void write(const Record& record);
+  std::ostream& writePath(const std::string& path);
+  void writeValue(const std::string& path, float val);
+  void writeValue(const std::string& path, std::int8_t val);
+
   const Settings& _settings;
-  NulOStream _nullStream;
+  std::ostream& _out;
+  std::mutex _outMutex;
+  RingBuffer<Record, recordQueueSize> _records;
+  // records queued by the logging thread, and written by the background
+  // thread, guarded by _wakeMutex
+  std::uint64_t _queued;
+  std::uint64_t _written;
+  std::uint64_t _droppedReported;
+  // formatted by the background thread
+  std::ostringstream _lines;
+  std::thread _thread;
+  std::atomic<bool> _running;
+  // the background thread sleeps while the queue is empty, and tells
+  // flush() when it has written records
+  std::atomic<bool> _sleeping;
+  std::mutex _wakeMutex;
+  std::condition_variable _wake;
+  std::condition_variable _flushed;
 };
@@ -0,0 +1,55 @@
+//
+//  MessageTemplate.cpp
+//  MyoOsc2
+//
+
+#include "MessageTemplate.h"
+#include <atomic>
+#include <utility>
+
+// Size of a string including its null terminator, padded to a multiple of 4.
+static std::size_t paddedSize(std::size_t length) {
+  return (length + 4) & ~static_cast<std::size_t>(3);
+}
+
+static std::size_t argumentSize(char typeTag, std::size_t blobSize) {
+  switch (typeTag) {
+    case 'i':
+    case 'f':
+      return 4;
+    case 'h':
+    case 'd':
+    case 't':
+      return 8;
+    case 'b':
+      return 4 + ((blobSize + 3) & ~static_cast<std::size_t>(3));
+    default:
+      return 0;
+  }
+}
+
+std::size_t MessageTemplate::nextId() {
+  static std::atomic<std::size_t> count(0);
+  return count.fetch_add(1, std::memory_order_relaxed);
+}
+
+MessageTemplate::MessageTemplate()
+: _id(nextId())
+, _typeTagOffset(0)
+, _argumentOffset(0) {}
+
+MessageTemplate::MessageTemplate(std::string address, const std::string& typeTags,
+                                 std::size_t blobSize)
+: _id(nextId())
+, _address(std::move(address)) {
+  std::size_t argumentsSize = 0;
+  for (char tag : typeTags) {
+    argumentsSize += argumentSize(tag, blobSize);
+  }
+  _typeTagOffset = paddedSize(_address.size()) + 1;
+  _argumentOffset = _typeTagOffset - 1 + paddedSize(typeTags.size() + 1);
+  _encoded.assign(_argumentOffset + argumentsSize, '\0');
+  _encoded.replace(0, _address.size(), _address);
+  _encoded[_typeTagOffset - 1] = ',';
+  _encoded.replace(_typeTagOffset, typeTags.size(), typeTags);
+}
@@ -0,0 +1,92 @@
+//
+//  MessageTemplate.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// A pre-encoded OSC message for a fixed address and type tag string.
+// The padded address, the type tags and the (zeroed) argument slots sit at
+// fixed offsets, so sending a message only takes copying the template and
+// writing the argument values into their slots.
+class MessageTemplate {
+public:
+  MessageTemplate();
+
+  // A blob type tag (b) reserves a blob of blobSize bytes.
+  MessageTemplate(std::string address, const std::string& typeTags,
+                  std::size_t blobSize = 0);
+
+  const std::string& address() const { return _address; }
+
+  // Small number that tells templates apart, for tables indexed by template.
+  // Copies share the id of the original.
+  std::size_t id() const { return _id; }
+
+  const char* data() const { return _encoded.data(); }
+
+  std::size_t size() const { return _encoded.size(); }
+
+  // Offset of the first type tag, just after the leading comma.
+  std::size_t typeTagOffset() const { return _typeTagOffset; }
+
+  // Offset of the first argument slot.
+  std::size_t argumentOffset() const { return _argumentOffset; }
+
+  // Copies the template into dest, which must have room for size() bytes,
+  // and returns the start of the copy.
+  char* write(char* dest) const {
+    std::memcpy(dest, _encoded.data(), _encoded.size());
+    return dest;
+  }
+
+private:
+  static std::size_t nextId();
+
+  std::size_t _id;
+  std::string _address;
+  std::string _encoded;
+  std::size_t _typeTagOffset;
+  std::size_t _argumentOffset;
+};
+
+// Writes a 32-bit value into an argument slot in OSC (big-endian) byte order
+// and returns the next slot.
+inline char* writeOscUInt32(char* slot, std::uint32_t val) {
+  slot[0] = static_cast<char>(val >> 24);
+  slot[1] = static_cast<char>(val >> 16);
+  slot[2] = static_cast<char>(val >> 8);
+  slot[3] = static_cast<char>(val);
+  return slot + 4;
+}
+
+inline char* writeOscArgument(char* slot, std::int32_t val) {
+  return writeOscUInt32(slot, static_cast<std::uint32_t>(val));
+}
+
+inline char* writeOscArgument(char* slot, float val) {
+  std::uint32_t bits;
+  std::memcpy(&bits, &val, sizeof(bits));
+  return writeOscUInt32(slot, bits);
+}
+
+inline char* writeOscArgument(char* slot, std::int64_t val) {
+  auto bits = static_cast<std::uint64_t>(val);
+  slot = writeOscUInt32(slot, static_cast<std::uint32_t>(bits >> 32));
+  return writeOscUInt32(slot, static_cast<std::uint32_t>(bits));
+}
+
+// Writes a blob of the size reserved in the template, including its size
+// and padding, and returns the next slot.
+inline char* writeOscBlob(char* slot, const void* data, std::size_t size) {
+  slot = writeOscUInt32(slot, static_cast<std::uint32_t>(size));
+  std::memcpy(slot, data, size);
+  auto padded = (size + 3) & ~static_cast<std::size_t>(3);
+  std::memset(slot + size, 0, padded - size);
+  return slot + padded;
+}
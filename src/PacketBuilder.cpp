@@ -0,0 +1,88 @@
+//
+//  PacketBuilder.cpp
+//  MyoOsc2
+//
+
+#include "PacketBuilder.h"
+#include <cstring>
+#include <stdexcept>
+
+// "#bundle" followed by the immediate time tag (1).
+static const char bundleHeader[16] = {
+  '#', 'b', 'u', 'n', 'd', 'l', 'e', '\0',
+  0, 0, 0, 0, 0, 0, 0, 1
+};
+
+void PacketBuilder::beginBundle() {
+  if (_bundleInProgress) {
+    endBundle();
+  }
+  if (_size + sizeof(bundleHeader) > _capacity) {
+    throw std::length_error("OSC packet buffer is full");
+  }
+  _bundleStart = _size;
+  _bundleMessageCount = 0;
+  std::memcpy(_data + _size, bundleHeader, sizeof(bundleHeader));
+  _size += sizeof(bundleHeader);
+  _bundleInProgress = true;
+}
+
+void PacketBuilder::endBundle() {
+  if (!_bundleInProgress) {
+    return;
+  }
+  _bundleInProgress = false;
+  if (_bundleMessageCount == 0) {
+    _size = _bundleStart;
+    return;
+  }
+  addPacket(_bundleStart, _size - _bundleStart, _bundleDestinations);
+}
+
+bool PacketBuilder::hasSpaceFor(const MessageTemplate& message,
+                                DestinationMask destinations) const {
+  if (needsNewBundle(destinations)) {
+    auto bundleSize = sizeof(bundleHeader) + 4 + message.size();
+    return _size + bundleSize <= _capacity
+      && bundleSize <= _maxPacketSize
+      && _packetCount + 1 < maxPackets;
+  }
+  if (_bundleInProgress) {
+    auto elementSize = 4 + message.size();
+    return _size + elementSize <= _capacity
+      && _size - _bundleStart + elementSize <= _maxPacketSize
+      && _packetCount < maxPackets;
+  }
+  return _size + message.size() <= _capacity
+    && _packetCount < maxPackets;
+}
+
+char* PacketBuilder::addMessage(const MessageTemplate& message,
+                                DestinationMask destinations) {
+  if (!hasSpaceFor(message, destinations)) {
+    throw std::length_error("OSC packet buffer is full");
+  }
+  if (needsNewBundle(destinations)) {
+    endBundle();
+    beginBundle();
+  }
+  if (_bundleInProgress) {
+    _bundleDestinations = destinations;
+    writeOscUInt32(_data + _size, static_cast<std::uint32_t>(message.size()));
+    _size += 4;
+    _bundleMessageCount++;
+  } else {
+    addPacket(_size, message.size(), destinations);
+  }
+  char* start = message.write(_data + _size);
+  _size += message.size();
+  return start;
+}
+
+void PacketBuilder::addPacket(std::size_t offset, std::size_t size,
+                              DestinationMask destinations) {
+  _packets[_packetCount].offset = offset;
+  _packets[_packetCount].size = size;
+  _packets[_packetCount].destinations = destinations;
+  _packetCount++;
+}
@@ -0,0 +1,100 @@
+//
+//  PacketBuilder.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "MessageTemplate.h"
+
+// Assembles a batch of OSC packets from message templates in a single
+// buffer. Each packet is either one bare message, or an immediate bundle
+// holding any number of messages.
+//
+// Every packet carries a mask of the destinations it is meant for. All
+// messages in a bundle share the same mask: adding a message for other
+// destinations starts a new bundle.
+class PacketBuilder {
+public:
+  using DestinationMask = std::uint32_t;
+
+  static const std::size_t maxPackets = 64;
+  static const DestinationMask allDestinations = ~DestinationMask(0);
+
+  PacketBuilder(char* buffer, std::size_t capacity, std::size_t maxPacketSize)
+  : _data(buffer)
+  , _capacity(capacity)
+  , _maxPacketSize(maxPacketSize)
+  , _size(0)
+  , _packetCount(0)
+  , _bundleStart(0)
+  , _bundleMessageCount(0)
+  , _bundleDestinations(allDestinations)
+  , _bundleInProgress(false) {}
+
+  // Drops all packets, including a bundle in progress.
+  void clear() {
+    _size = 0;
+    _packetCount = 0;
+    _bundleInProgress = false;
+  }
+
+  void beginBundle();
+
+  // Adds the bundle in progress to the batch, unless it has no messages.
+  void endBundle();
+
+  bool isBundleInProgress() const { return _bundleInProgress; }
+
+  // Whether the message can be added without overflowing the buffer, the
+  // maximum packet size or the maximum number of packets.
+  bool hasSpaceFor(const MessageTemplate& message,
+                   DestinationMask destinations = allDestinations) const;
+
+  // Whether there is room for another packet of the maximum packet size.
+  bool hasSpaceForPacket() const {
+    return _capacity - _size >= _maxPacketSize && _packetCount < maxPackets;
+  }
+
+  // Appends a copy of the message template, either to the bundle in progress
+  // or as a packet of its own, and returns the start of the copy so that the
+  // caller can fill in its arguments.
+  char* addMessage(const MessageTemplate& message,
+                   DestinationMask destinations = allDestinations);
+
+  bool empty() const { return _packetCount == 0; }
+  std::size_t packetCount() const { return _packetCount; }
+  const char* packetData(std::size_t i) const { return _data + _packets[i].offset; }
+  std::size_t packetSize(std::size_t i) const { return _packets[i].size; }
+  DestinationMask packetDestinations(std::size_t i) const { return _packets[i].destinations; }
+
+private:
+  struct Packet {
+    std::size_t offset;
+    std::size_t size;
+    DestinationMask destinations;
+  };
+
+  // Whether a message for these destinations can't join the bundle in
+  // progress and needs a bundle of its own.
+  bool needsNewBundle(DestinationMask destinations) const {
+    return _bundleInProgress && _bundleMessageCount > 0
+      && destinations != _bundleDestinations;
+  }
+
+  void addPacket(std::size_t offset, std::size_t size, DestinationMask destinations);
+
+  char* _data;
+  std::size_t _capacity;
+  std::size_t _maxPacketSize;
+  std::size_t _size;
+  std::array<Packet, maxPackets> _packets;
+  std::size_t _packetCount;
+  std::size_t _bundleStart;
+  std::size_t _bundleMessageCount;
+  DestinationMask _bundleDestinations;
+  bool _bundleInProgress;
+};
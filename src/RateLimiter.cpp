@@ -0,0 +1,92 @@
+//
+//  RateLimiter.cpp
+//  MyoOsc2
+//
+
+#include "RateLimiter.h"
+#include <algorithm>
+
+bool streamClassOf(EventType type, StreamClass& streamClass) {
+  switch (type) {
+    case EventType::orientation:
+      streamClass = StreamClass::orientation;
+      return true;
+    case EventType::accelerometer:
+      streamClass = StreamClass::accel;
+      return true;
+    case EventType::gyroscope:
+      streamClass = StreamClass::gyro;
+      return true;
+    case EventType::emg:
+      streamClass = StreamClass::emg;
+      return true;
+    case EventType::rssi:
+      streamClass = StreamClass::rssi;
+      return true;
+    default:
+      return false;
+  }
+}
+
+RateLimiter::RateLimiter(const Settings& settings)
+: _pendingCount(0)
+, _enabled(false) {
+  auto now = Clock::now();
+  for (std::size_t c = 0; c < numStreamClasses; c++) {
+    auto& schedule = _schedules[c];
+    auto rate = settings.rates[c];
+    schedule.limited = rate > 0;
+    schedule.period = schedule.limited
+      ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate))
+      : Clock::duration::zero();
+    schedule.next = now;
+    _enabled = _enabled || schedule.limited;
+  }
+}
+
+bool RateLimiter::hold(const EventRecord& record) {
+  StreamClass streamClass;
+  if (!_enabled || !streamClassOf(record.type, streamClass)) {
+    return false;
+  }
+  auto c = static_cast<std::size_t>(streamClass);
+  if (!_schedules[c].limited) {
+    return false;
+  }
+  if (record.deviceId >= _samples.size()) {
+    DeviceSamples empty;
+    for (auto& sample : empty) {
+      sample.pending = false;
+    }
+    _samples.resize(record.deviceId + 1, empty);
+  }
+  auto& sample = _samples[record.deviceId][c];
+  if (!sample.pending) {
+    sample.pending = true;
+    _pendingCount++;
+  }
+  sample.record = record;
+  return true;
+}
+
+void RateLimiter::drop(std::uint32_t deviceId) {
+  if (deviceId >= _samples.size()) {
+    return;
+  }
+  for (auto& sample : _samples[deviceId]) {
+    if (sample.pending) {
+      sample.pending = false;
+      _pendingCount--;
+    }
+  }
+}
+
+RateLimiter::Clock::time_point RateLimiter::nextDue() const {
+  auto next = Clock::time_point::max();
+  for (const auto& schedule : _schedules) {
+    if (schedule.limited) {
+      next = std::min(next, schedule.next);
+    }
+  }
+  return next;
+}
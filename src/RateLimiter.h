@@ -0,0 +1,94 @@
+//
+//  RateLimiter.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <vector>
+#include "EventRecord.h"
+#include "Settings.h"
+
+// Gets the stream class of a sample event. Returns false for other events.
+bool streamClassOf(EventType type, StreamClass& streamClass);
+
+// Holds back samples of rate limited streams, keeping only the latest one
+// per device and stream, and releases them on a fixed schedule. Not thread
+// safe: it lives on the thread that encodes the messages.
+class RateLimiter {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit RateLimiter(const Settings& settings);
+
+  bool enabled() const { return _enabled; }
+  bool limited(StreamClass streamClass) const {
+    return _schedules[static_cast<std::size_t>(streamClass)].limited;
+  }
+
+  // Keeps the record and returns true if its stream is rate limited.
+  // Otherwise the record should be sent right away.
+  bool hold(const EventRecord& record);
+
+  bool hasPending() const { return _pendingCount > 0; }
+
+  // Forgets the samples held for a device, so that none of them are sent
+  // after its disconnect.
+  void drop(std::uint32_t deviceId);
+
+  // Earliest time at which a rate limited stream is due.
+  Clock::time_point nextDue() const;
+
+  // Calls emit with the latest held sample of each device for every stream
+  // that is due.
+  template<typename F>
+  void emitDue(Clock::time_point now, F emit);
+
+private:
+  struct Schedule {
+    bool limited;
+    Clock::duration period;
+    Clock::time_point next;
+  };
+
+  struct Sample {
+    bool pending;
+    EventRecord record;
+  };
+
+  using DeviceSamples = std::array<Sample, numStreamClasses>;
+
+  std::array<Schedule, numStreamClasses> _schedules;
+  // indexed by device id
+  std::vector<DeviceSamples> _samples;
+  std::size_t _pendingCount;
+  bool _enabled;
+};
+
+template<typename F>
+void RateLimiter::emitDue(Clock::time_point now, F emit) {
+  if (!_pendingCount) {
+    return;
+  }
+  for (std::size_t c = 0; c < numStreamClasses; c++) {
+    auto& schedule = _schedules[c];
+    if (!schedule.limited || now < schedule.next) {
+      continue;
+    }
+    for (auto& samples : _samples) {
+      auto& sample = samples[c];
+      if (sample.pending) {
+        sample.pending = false;
+        _pendingCount--;
+        emit(sample.record);
+      }
+    }
+    // stay on the fixed schedule, unless we have fallen behind it
+    schedule.next += schedule.period;
+    if (schedule.next < now) {
+      schedule.next = now + schedule.period;
+    }
+  }
+}
@@ -0,0 +1,72 @@
+//
+//  RingBuffer.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity must be a power of two. When the queue is full, push()
+// drops the new item and counts it as an overflow.
+template<typename T, std::size_t Capacity>
+class RingBuffer {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "RingBuffer capacity must be a power of two");
+public:
+  RingBuffer()
+  : _head(0)
+  , _tail(0)
+  , _overflows(0) {}
+
+  // Producer side.
+  bool push(const T& item) {
+    auto head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) == Capacity) {
+      _overflows.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    _items[head & (Capacity - 1)] = item;
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side.
+  bool pop(T& item) {
+    auto tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = _items[tail & (Capacity - 1)];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Number of queued items. Only a snapshot when called while the other
+  // side is active.
+  std::size_t size() const {
+    return static_cast<std::size_t>(_head.load(std::memory_order_acquire)
+                                    - _tail.load(std::memory_order_acquire));
+  }
+
+  bool empty() const { return size() == 0; }
+
+  static constexpr std::size_t capacity() { return Capacity; }
+
+  // Number of items dropped because the queue was full.
+  std::uint64_t overflows() const {
+    return _overflows.load(std::memory_order_relaxed);
+  }
+
+private:
+  // head and tail live on separate cache lines so that the producer and
+  // consumer don't keep invalidating each other's line.
+  alignas(64) std::atomic<std::uint64_t> _head;
+  alignas(64) std::atomic<std::uint64_t> _tail;
+  alignas(64) std::atomic<std::uint64_t> _overflows;
+  std::array<T, Capacity> _items;
+};
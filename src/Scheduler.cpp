@@ -0,0 +1,60 @@
+//
+//  Scheduler.cpp
+//  MyoOsc2
+//
+
+#include "Scheduler.h"
+#include <algorithm>
+
+Scheduler::Scheduler()
+: _running(false) {}
+
+Scheduler::~Scheduler() {
+  stop();
+}
+
+void Scheduler::every(Clock::duration interval, Task task) {
+  _entries.push_back({interval, Clock::now() + interval, std::move(task)});
+}
+
+void Scheduler::start() {
+  if (_entries.empty() || _thread.joinable()) {
+    return;
+  }
+  _running = true;
+  _thread = std::thread(&Scheduler::run, this);
+}
+
+void Scheduler::stop() {
+  if (!_thread.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _running = false;
+  }
+  _wake.notify_one();
+  _thread.join();
+}
+
+void Scheduler::run() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (_running) {
+    auto now = Clock::now();
+    auto next = Clock::time_point::max();
+    for (auto& entry : _entries) {
+      if (entry.next <= now) {
+        lock.unlock();
+        entry.task();
+        lock.lock();
+        // skip runs that were missed rather than catching up on them
+        entry.next += entry.interval;
+        if (entry.next <= now) {
+          entry.next = now + entry.interval;
+        }
+      }
+      next = std::min(next, entry.next);
+    }
+    _wake.wait_until(lock, next, [this] { return !_running; });
+  }
+}
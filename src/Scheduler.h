@@ -0,0 +1,47 @@
+//
+//  Scheduler.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs periodic tasks on a background thread. Tasks should be short; work
+// that has to happen on another thread should be posted to it, e.g. with a
+// CommandQueue.
+class Scheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Task = std::function<void()>;
+
+  Scheduler();
+  ~Scheduler();
+
+  // Adds a task to run every interval, starting one interval from now.
+  // Must be called before start().
+  void every(Clock::duration interval, Task task);
+
+  void start();
+  void stop();
+
+private:
+  struct Entry {
+    Clock::duration interval;
+    Clock::time_point next;
+    Task task;
+  };
+
+  void run();
+
+  std::vector<Entry> _entries;
+  std::thread _thread;
+  std::mutex _mutex;
+  std::condition_variable _wake;
+  bool _running;
+};
@@ -5,6 +5,7 @@
 
 #include "Settings.h"
 #include "optionparser.h"
+#include <cstdlib>
 #include <iostream>
 #include <vector>
 
@@ -19,6 +20,15 @@ struct Arg : public option::Arg {
     if (msg) printError("Unknown option '", option, "'\n");
     return option::ARG_ILLEGAL;
   }
+
+  static option::ArgStatus Required(const option::Option& option, bool msg)
+  {
+    if (option.arg != 0)
+      return option::ARG_OK;
+
+    if (msg) printError("Option '", option, "' requires an argument\n");
+    return option::ARG_ILLEGAL;
+  }
 };
 
 enum OptionIndex {
@@ -26,6 +36,26 @@ enum OptionIndex {
   HELP,
   LOG,
   VERBOSE,
+  BUNDLE,
+  SCHEMA,
+  EULER,
+  SENDER_THREAD,
+  DEST,
+  RATE,
+  DEADBAND,
+  REFRESH,
+  EMG_BATCH,
+  EMG_BLOB,
+  EMG_RMS,
+  EMG_SPECTRUM,
+  GESTURE_MODEL,
+  INTERVAL,
+  CAPTURE,
+  REPLAY,
+  REPLAY_FAST,
+  CONTROL,
+  LEASE,
+  TRACE,
 };
 enum OptionType {DISABLE, ENABLE, OTHER};
 
@@ -34,6 +64,7 @@ const char usageText[] =
 "   MyoOsc2 sends OSC output over UDP from the input of one or more Thalmic Myo armbands.\n"
 "   IP address defaults to 127.0.0.1/localhost\n"
 "   Port defaults to 7777\n"
+"   Use --dest to send to several destinations at once.\n"
 "   by tekt@optexture.com\n"
 "   based on myo-osc by Samy Kamkar -- code@samy.pl\n";
 
@@ -42,10 +73,160 @@ const option::Descriptor usage[] =
   {UNKNOWN,     0,            "",   "",           Arg::Unknown,   usageText},
   {LOG,         ENABLE,       "l",  "log",        Arg::None,      "--log Enable standard logging."},
   {VERBOSE,     ENABLE,       "v",  "verbose",    Arg::None,      "--log Enable verbose debug logging." },
+  {BUNDLE,      ENABLE,       "b",  "bundle",     Arg::None,      "--bundle Send all messages produced by one event as a single OSC bundle."},
+  {SCHEMA,      OTHER,        "",   "schema",     Arg::Required,  "--schema=<components|vectors> Send vectors as one message per component (default) or as a single message."},
+  {EULER,       OTHER,        "",   "euler",      Arg::Required,  "--euler=<exact|fast> Compute the orientVec Euler angles with the standard library functions (default), or with faster approximations that are within 0.0002 degrees of them."},
+  {SENDER_THREAD, DISABLE,    "",   "sync",       Arg::None,      "--sync Encode and send messages on the Myo event thread instead of a separate sender thread."},
+  {DEST,        OTHER,        "d",  "dest",       Arg::Required,  "--dest=<host:port[/prefix]> Send to this destination. May be repeated. With a prefix, only messages whose address starts with it are sent, e.g. --dest=localhost:9000/myo/0/emg"},
+  {RATE,        OTHER,        "r",  "rate",       Arg::Required,  "--rate=[<stream>:]<hz> Send at most <hz> samples per second of a stream (orientation, accel, gyro, emg or rssi), or of all of them when no stream is given. Only the latest sample per device is kept between sends. May be repeated."},
+  {DEADBAND,    OTHER,        "",   "deadband",   Arg::Required,  "--deadband=[<stream>:]<threshold>[%] Don't send a sample of a stream (orientation, accel, gyro, emg or rssi), or of all of them when no stream is given, while no value has changed by more than the threshold since the last sample sent, or by more than a percentage of it when followed by %. May be repeated."},
+  {REFRESH,     OTHER,        "",   "refresh",    Arg::Required,  "--refresh=<seconds> Send a sample of a stream with a deadband at least this often. Defaults to 1."},
+  {EMG_BATCH,   OTHER,        "",   "emg-batch",  Arg::Required,  "--emg-batch=<frames> Send EMG as one <path>/emg/batch message per <frames> frames (1 to 100), with the timestamp of the first frame (int64, microseconds), the sample period (int32, microseconds) and the int8 samples of all frames in one blob, 8 per frame."},
+  {EMG_BLOB,    ENABLE,       "",   "emg-blob",   Arg::None,      "--emg-blob Send each EMG frame as a single <path>/emg message with a blob of 8 int8 samples. Can't be combined with --emg-batch."},
+  {EMG_RMS,     OTHER,        "",   "emg-rms",    Arg::Required,  "--emg-rms=<frames>[:<every>] Send the RMS and the mean absolute value of each EMG channel over the last <frames> frames (1 to 1000, at 200 frames per second) as <path>/emg/rms and <path>/emg/mav (8 floats each, whatever the --schema), every <every> frames (by default <frames>). Every frame counts, even those a rate limit or deadband keeps from being sent. Leave out the raw EMG with --dest prefixes or subscriptions."},
+  {EMG_SPECTRUM, OTHER,       "",   "emg-spectrum", Arg::Required, "--emg-spectrum=<frames>[:<every>] Send the power in four equal frequency bands up to 100 Hz, the mean and the median frequency of each EMG channel, from an FFT of the last <frames> frames (a power of two from 16 to 1024), every <every> frames (by default <frames>/2), as <path>/emg/bands (8 channels of 4 floats), <path>/emg/meanFreq and <path>/emg/medianFreq (8 floats, Hz). The FFTs run on a thread of their own."},
+  {GESTURE_MODEL, OTHER,      "",   "gesture-model", Arg::Required, "--gesture-model=<file> Classify EMG gestures with a linear model trained offline (see GestureModel.h for the file format), and send the class (int32, numbered in the order of the model file) and its probability (float) as <path>/gesture every time the model asks for a prediction."},
+  {INTERVAL,    OTHER,        "",   "interval",   Arg::Required,  "--interval=<task>:<seconds> Run a periodic task every <seconds>, or never when 0: rssi and battery request the RSSI and battery level of every Myo, poses resets the pose states, stats logs sender statistics (every 10 seconds by default), latency sends the p50, p90, p99 and max latency since the last time for each stream as /myoosc/stats/latency/<stream> (count int64, then microseconds as floats). May be repeated."},
+  {CAPTURE,     OTHER,        "",   "capture",    Arg::Required,  "--capture=<file> Record every Myo event to a binary event log."},
+  {REPLAY,      OTHER,        "",   "replay",     Arg::Required,  "--replay=<file> Send the events of a log recorded with --capture in real time instead of connecting to Myo Connect, then exit."},
+  {REPLAY_FAST, ENABLE,       "",   "replay-fast", Arg::None,     "--replay-fast Replay the log as fast as possible."},
+  {CONTROL,     OTHER,        "",   "control",    Arg::Required,  "--control=<port> Listen for subscriptions on this UDP port: /myoosc/subscribe <pattern> [<host> <port>] sends the messages whose address matches the OSC address pattern (or lies below it, e.g. /myo/0) to the host and port, or to the sender of the request when they are left out; /myoosc/unsubscribe with the same arguments ends it. Messages nobody subscribed to aren't encoded at all. Other destinations are sent to as before, but there is no default one."},
+  {LEASE,       OTHER,        "",   "lease",      Arg::Required,  "--lease=<seconds> End a subscription that isn't renewed by subscribing again within this time. Defaults to 60."},
+  {TRACE,       OTHER,        "",   "trace",      Arg::Required,  "--trace=<file> Record a timeline of Myo event delivery, encoding, sending and verbose logging, and write it to <file> as a Chrome trace (open it in chrome://tracing or ui.perfetto.dev) on exit, or on SIGUSR1 where there is one."},
   {HELP,        0,            "",   "help",       Arg::None,      "--help Print usage and exit."},
   {0, 0, 0, 0, 0, 0},
 };
 
+// Parses host:port[/prefix].
+static bool parseDestination(const std::string& text, Destination& dest) {
+  auto colon = text.find(':');
+  if (colon == std::string::npos || colon == 0) {
+    return false;
+  }
+  auto slash = text.find('/', colon);
+  auto portText = text.substr(colon + 1, slash == std::string::npos ? std::string::npos : slash - colon - 1);
+  if (portText.empty() || portText.find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  dest.hostname = text.substr(0, colon);
+  dest.port = std::atoi(portText.c_str());
+  dest.prefix = slash == std::string::npos ? "" : text.substr(slash);
+  return dest.port > 0 && dest.port <= 65535;
+}
+
+// Parses [<stream>:]<value> into the entry of the named stream class, or
+// into all of them when no stream is given.
+template<typename T, typename ParseValue>
+static bool parsePerStream(const std::string& text,
+                           std::array<T, numStreamClasses>& values,
+                           ParseValue parseValue) {
+  static const std::array<std::string, numStreamClasses> names = {
+    "orientation", "accel", "gyro", "emg", "rssi"
+  };
+  auto colon = text.find(':');
+  T value;
+  if (!parseValue(colon == std::string::npos ? text : text.substr(colon + 1), value)) {
+    return false;
+  }
+  if (colon == std::string::npos) {
+    values.fill(value);
+    return true;
+  }
+  auto name = text.substr(0, colon);
+  for (std::size_t i = 0; i < numStreamClasses; i++) {
+    if (names[i] == name) {
+      values[i] = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool parseNonNegative(const std::string& text, double& value) {
+  char* end = nullptr;
+  value = std::strtod(text.c_str(), &end);
+  return !text.empty() && *end == '\0' && value >= 0;
+}
+
+// Parses an absolute threshold, or a relative one with a % suffix.
+static bool parseDeadband(const std::string& text, Deadband& deadband) {
+  deadband.relative = !text.empty() && text.back() == '%';
+  if (!parseNonNegative(deadband.relative ? text.substr(0, text.size() - 1) : text,
+                        deadband.threshold)) {
+    return false;
+  }
+  if (deadband.relative) {
+    deadband.threshold /= 100;
+  }
+  return true;
+}
+
+// Parses <task>:<seconds>.
+static bool parseInterval(const std::string& text, Settings& settings) {
+  auto colon = text.find(':');
+  if (colon == std::string::npos) {
+    return false;
+  }
+  auto task = text.substr(0, colon);
+  double* interval = nullptr;
+  if (task == "rssi") {
+    interval = &settings.rssiInterval;
+  } else if (task == "battery") {
+    interval = &settings.batteryInterval;
+  } else if (task == "poses") {
+    interval = &settings.poseFlushInterval;
+  } else if (task == "stats") {
+    interval = &settings.statsInterval;
+  } else if (task == "latency") {
+    interval = &settings.latencyInterval;
+  } else {
+    return false;
+  }
+  return parseNonNegative(text.substr(colon + 1), *interval);
+}
+
+// Parses a whole number of frames from 1 to max.
+static bool parseFrames(const std::string& text, std::size_t max, std::size_t& frames) {
+  double value;
+  if (!parseNonNegative(text, value) || value < 1 || value > max
+      || value != static_cast<std::size_t>(value)) {
+    return false;
+  }
+  frames = static_cast<std::size_t>(value);
+  return true;
+}
+
+// Parses <frames>[:<every>].
+static bool parseEmgEnvelope(const std::string& text, Settings& settings) {
+  auto colon = text.find(':');
+  if (!parseFrames(text.substr(0, colon), Settings::maxEmgEnvelopeFrames,
+                   settings.emgEnvelopeWindow)) {
+    return false;
+  }
+  if (colon == std::string::npos) {
+    settings.emgEnvelopeEvery = settings.emgEnvelopeWindow;
+    return true;
+  }
+  return parseFrames(text.substr(colon + 1), Settings::maxEmgEnvelopeFrames,
+                     settings.emgEnvelopeEvery);
+}
+
+// Parses <frames>[:<every>], where frames is a power of two.
+static bool parseEmgSpectrum(const std::string& text, Settings& settings) {
+  auto colon = text.find(':');
+  auto& window = settings.emgSpectrumWindow;
+  if (!parseFrames(text.substr(0, colon), Settings::maxEmgSpectrumFrames, window)
+      || window < Settings::minEmgSpectrumFrames || (window & (window - 1)) != 0) {
+    return false;
+  }
+  if (colon == std::string::npos) {
+    settings.emgSpectrumEvery = window / 2;
+    return true;
+  }
+  return parseFrames(text.substr(colon + 1), Settings::maxEmgSpectrumFrames,
+                     settings.emgSpectrumEvery);
+}
+
 bool Settings::parseArgs(int argc, char **argv) {
   argc-=(argc>0); argv+=(argc>0); // skip program name argv[0] if present
   option::Stats  stats(usage, argc, argv);
@@ -62,10 +243,34 @@ bool Settings::parseArgs(int argc, char **argv) {
     return false;
   }
 
-  port = 7777;
-  hostname = "127.0.0.1";
+  destinations.clear();
   logging = true;
   verbose = false;
+  bundle = false;
+  schema = PathSchema::components;
+  euler = EulerPrecision::exact;
+  senderThread = true;
+  rates.fill(0);
+  deadbands.fill({0, false});
+  maxSilence = 1;
+  emgBatchFrames = 0;
+  emgBlob = false;
+  emgEnvelopeWindow = 0;
+  emgEnvelopeEvery = 0;
+  emgSpectrumWindow = 0;
+  emgSpectrumEvery = 0;
+  gestureModelFile.clear();
+  rssiInterval = 0;
+  batteryInterval = 0;
+  poseFlushInterval = 0;
+  statsInterval = 10;
+  latencyInterval = 0;
+  captureFile.clear();
+  replayFile.clear();
+  replayFast = false;
+  controlPort = 0;
+  leaseTimeout = 60;
+  traceFile.clear();
 
   for (const auto& opt : options) {
     switch (opt.index()) {
@@ -75,6 +280,109 @@ bool Settings::parseArgs(int argc, char **argv) {
       case VERBOSE:
         verbose = opt.type() == ENABLE;
         break;
+      case BUNDLE:
+        bundle = opt.type() == ENABLE;
+        break;
+      case SCHEMA:
+        if (std::string(opt.arg) == "components") {
+          schema = PathSchema::components;
+        } else if (std::string(opt.arg) == "vectors") {
+          schema = PathSchema::vectors;
+        } else {
+          std::cerr << "Unknown path schema: " << opt.arg << "\n\n";
+          option::printUsage(std::cerr, usage);
+          return false;
+        }
+        break;
+      case EULER:
+        if (std::string(opt.arg) == "exact") {
+          euler = EulerPrecision::exact;
+        } else if (std::string(opt.arg) == "fast") {
+          euler = EulerPrecision::fast;
+        } else {
+          std::cerr << "Unknown Euler angle precision: " << opt.arg << "\n\n";
+          option::printUsage(std::cerr, usage);
+          return false;
+        }
+        break;
+      case SENDER_THREAD:
+        senderThread = opt.type() == ENABLE;
+        break;
+      case REFRESH:
+        if (!parseNonNegative(opt.arg, maxSilence)) {
+          std::cerr << "Invalid refresh interval: " << opt.arg << "\n\n";
+          option::printUsage(std::cerr, usage);
+          return false;
+        }
+        break;
+      case EMG_BATCH:
+        if (!parseFrames(opt.arg, maxEmgBatchFrames, emgBatchFrames)) {
+          std::cerr << "Invalid EMG batch size: " << opt.arg << "\n\n";
+          option::printUsage(std::cerr, usage);
+          return false;
+        }
+        break;
+      case EMG_BLOB:
+        emgBlob = opt.type() == ENABLE;
+        break;
+      case EMG_RMS:
+        if (!parseEmgEnvelope(opt.arg, *this)) {
+          std::cerr << "Invalid EMG RMS window: " << opt.arg << "\n\n";
+          option::printUsage(std::cerr, usage);
+          return false;
+        }
+        break;
+      case EMG_SPECTRUM:
+        if (!parseEmgSpectrum(opt.arg, *this)) {
+          std::cerr << "Invalid EMG spectrum window: " << opt.arg << "\n\n";
+          option::printUsage(std::cerr, usage);
+          return false;
+        }
+        break;
+      case GESTURE_MODEL:
+        gestureModelFile = opt.arg;
+        break;
+      case INTERVAL:
+        if (!parseInterval(opt.arg, *this)) {
+          std::cerr << "Invalid interval: " << opt.arg << "\n\n";
+          option::printUsage(std::cerr, usage);
+          return false;
+        }
+        break;
+      case CAPTURE:
+        captureFile = opt.arg;
+        break;
+      case REPLAY:
+        replayFile = opt.arg;
+        break;
+      case REPLAY_FAST:
+        replayFast = opt.type() == ENABLE;
+        break;
+      case TRACE:
+        traceFile = opt.arg;
+        break;
+      case CONTROL: {
+        double port;
+        if (!parseNonNegative(opt.arg, port) || port < 1 || port > 65535 || port != static_cast<int>(port)) {
+          std::cerr << "Invalid control port: " << opt.arg << "\n\n";
+          option::printUsage(std::cerr, usage);
+          return false;
+        }
+        controlPort = static_cast<int>(port);
+        break;
+      }
+      case LEASE:
+        if (!parseNonNegative(opt.arg, leaseTimeout) || leaseTimeout == 0) {
+          std::cerr << "Invalid lease: " << opt.arg << "\n\n";
+          option::printUsage(std::cerr, usage);
+          return false;
+        }
+        break;
+      case DEST:
+      case RATE:
+      case DEADBAND:
+        // handled below, since these options can be repeated
+        break;
       case UNKNOWN:
         std::cerr << "Unknown option: " << std::string(opt.name, opt.namelen) << "\n\n";
         option::printUsage(std::cerr, usage);
@@ -83,15 +391,51 @@ bool Settings::parseArgs(int argc, char **argv) {
         break;
     }
   }
+  for (option::Option* opt = options[DEST]; opt; opt = opt->next()) {
+    Destination dest;
+    if (!parseDestination(opt->arg, dest)) {
+      std::cerr << "Invalid destination: " << opt->arg << "\n\n";
+      option::printUsage(std::cerr, usage);
+      return false;
+    }
+    destinations.push_back(dest);
+  }
+  for (option::Option* opt = options[RATE]; opt; opt = opt->next()) {
+    if (!parsePerStream(opt->arg, rates, parseNonNegative)) {
+      std::cerr << "Invalid rate: " << opt->arg << "\n\n";
+      option::printUsage(std::cerr, usage);
+      return false;
+    }
+  }
+  for (option::Option* opt = options[DEADBAND]; opt; opt = opt->next()) {
+    if (!parsePerStream(opt->arg, deadbands, parseDeadband)) {
+      std::cerr << "Invalid deadband: " << opt->arg << "\n\n";
+      option::printUsage(std::cerr, usage);
+      return false;
+    }
+  }
+  // both change how each EMG frame is sent
+  if (emgBatchFrames > 0 && emgBlob) {
+    std::cerr << "Invalid EMG options: --emg-batch and --emg-blob can't be combined\n\n";
+    option::printUsage(std::cerr, usage);
+    return false;
+  }
   if (parse.nonOptionsCount() == 2) {
-    hostname = parse.nonOption(0);
-    port = std::atoi(parse.nonOption(1));
+    destinations.push_back({parse.nonOption(0), std::atoi(parse.nonOption(1)), ""});
   } else if (parse.nonOptionsCount() == 1) {
-    port = std::atoi(parse.nonOption(0));
+    destinations.push_back({"127.0.0.1", std::atoi(parse.nonOption(0)), ""});
   } else if (parse.nonOptionsCount() != 0) {
     std::cerr << "strange number of non-option arguments: " << parse.nonOptionsCount() << "\n\n";
     option::printUsage(std::cerr, usage);
     return false;
   }
+  // with subscriptions, nothing is sent that nobody asked for
+  if (destinations.empty() && controlPort == 0) {
+    destinations.push_back({"127.0.0.1", 7777, ""});
+  }
+  if (destinations.size() > maxDestinations) {
+    std::cerr << "Too many destinations, at most " << maxDestinations << " are supported\n\n";
+    return false;
+  }
   return true;
 }
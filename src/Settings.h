@@ -6,20 +6,137 @@
 
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <string>
+#include <vector>
+#include "Euler.h"
+
+enum class PathSchema {
+  // one message per component, e.g. /myo/0/accel/x
+  components,
+  // one message per vector value, e.g. /myo/0/accel ,fff
+  vectors,
+};
+
+// Sample streams whose output rate can be limited.
+enum class StreamClass {
+  orientation,
+  accel,
+  gyro,
+  emg,
+  rssi,
+};
+
+const std::size_t numStreamClasses = 5;
+
+// Latency is tracked for each stream class, plus one class for all other
+// events.
+const std::size_t numLatencyClasses = numStreamClasses + 1;
+
+// Samples of a stream are only sent when a value has changed by more than
+// the threshold, or by more than that fraction of its last sent value when
+// relative. A threshold of 0 sends every sample.
+struct Deadband {
+  double threshold;
+  bool relative;
+};
+
+// An OSC receiver. When prefix is set, only messages whose address starts
+// with it are sent to this destination.
+struct Destination {
+  std::string hostname;
+  int port;
+  std::string prefix;
+};
 
 class Settings {
 public:
   Settings()
-  : hostname("localhost")
-  , port(7777)
+  : destinations({{"localhost", 7777, ""}})
   , logging(true)
-  , verbose(false) {}
+  , verbose(false)
+  , bundle(false)
+  , schema(PathSchema::components)
+  , euler(EulerPrecision::exact)
+  , senderThread(true)
+  , rates()
+  , deadbands()
+  , maxSilence(1)
+  , emgBatchFrames(0)
+  , emgBlob(false)
+  , emgEnvelopeWindow(0)
+  , emgEnvelopeEvery(0)
+  , emgSpectrumWindow(0)
+  , emgSpectrumEvery(0)
+  , rssiInterval(0)
+  , batteryInterval(0)
+  , poseFlushInterval(0)
+  , statsInterval(10)
+  , latencyInterval(0)
+  , replayFast(false)
+  , controlPort(0)
+  , leaseTimeout(60) {}
 
   bool parseArgs(int argc, char **argv);
 
-  std::string hostname;
-  int port;
+  static const std::size_t maxDestinations = 32;
+  static const std::size_t maxEmgBatchFrames = 100;
+  static const std::size_t maxEmgEnvelopeFrames = 1000;
+  static const std::size_t minEmgSpectrumFrames = 16;
+  static const std::size_t maxEmgSpectrumFrames = 1024;
+
+  std::vector<Destination> destinations;
   bool logging;
   bool verbose;
+  bool bundle;
+  PathSchema schema;
+  // How orientVec is computed from the orientation quaternion.
+  EulerPrecision euler;
+  bool senderThread;
+  // Maximum number of samples per second sent for each stream class, or 0
+  // to send every sample.
+  std::array<double, numStreamClasses> rates;
+  std::array<Deadband, numStreamClasses> deadbands;
+  // Seconds after which a sample is sent even if it is inside the deadband.
+  double maxSilence;
+  // Number of EMG frames sent together in one batch message, or 0 to send
+  // every frame on its own.
+  std::size_t emgBatchFrames;
+  // Send each EMG frame as a single 8 byte blob.
+  bool emgBlob;
+  // Number of EMG frames over which the RMS and mean absolute value of each
+  // channel are computed, or 0 for none, and the number of frames between
+  // sending them. See EmgEnvelope.
+  std::size_t emgEnvelopeWindow;
+  std::size_t emgEnvelopeEvery;
+  // Number of EMG frames in the FFT window of the band power and frequency
+  // features, or 0 for none, and the number of frames between them. See
+  // EmgSpectrum.
+  std::size_t emgSpectrumWindow;
+  std::size_t emgSpectrumEvery;
+  // Classify EMG gestures with the model in this file, see GestureModel.
+  std::string gestureModelFile;
+  // Seconds between periodic tasks, or 0 to disable them: RSSI and battery
+  // level requests, resetting the pose states, logging stats, and sending
+  // latency percentiles.
+  double rssiInterval;
+  double batteryInterval;
+  double poseFlushInterval;
+  double statsInterval;
+  double latencyInterval;
+  // Record every Myo event to this file, see EventCapture.
+  std::string captureFile;
+  // Send the events of a recorded log instead of those of live Myos, in
+  // real time or as fast as possible.
+  std::string replayFile;
+  bool replayFast;
+  // UDP port to listen on for subscriptions, or 0 for none, see
+  // ControlServer. Subscribers take the destination slots left over by the
+  // fixed destinations.
+  int controlPort;
+  // Seconds after which a subscription that isn't renewed ends.
+  double leaseTimeout;
+  // Write a timeline of the event pipeline to this file, see Trace.
+  std::string traceFile;
 };
@@ -0,0 +1,205 @@
+//
+//  Subscriptions.cpp
+//  MyoOsc2
+//
+
+#include "Subscriptions.h"
+#include <algorithm>
+
+// Matches one path segment of a pattern, [p, pe), against one of an
+// address, [a, ae).
+static bool matchesSegment(const char* p, const char* pe, const char* a, const char* ae) {
+  while (p != pe) {
+    switch (*p) {
+      case '?':
+        if (a == ae) {
+          return false;
+        }
+        p++;
+        a++;
+        break;
+      case '*':
+        p++;
+        for (const char* rest = a; ; rest++) {
+          if (matchesSegment(p, pe, rest, ae)) {
+            return true;
+          }
+          if (rest == ae) {
+            return false;
+          }
+        }
+      case '[': {
+        if (a == ae) {
+          return false;
+        }
+        p++;
+        bool negate = p != pe && *p == '!';
+        if (negate) {
+          p++;
+        }
+        bool found = false;
+        while (p != pe && *p != ']') {
+          if (pe - p > 2 && p[1] == '-' && p[2] != ']') {
+            found = found || (*a >= p[0] && *a <= p[2]);
+            p += 3;
+          } else {
+            found = found || *a == *p;
+            p++;
+          }
+        }
+        if (p == pe || found == negate) {
+          return false;
+        }
+        p++;
+        a++;
+        break;
+      }
+      case '{': {
+        const char* close = std::find(p, pe, '}');
+        if (close == pe) {
+          return false;
+        }
+        for (const char* option = p + 1; ; ) {
+          const char* comma = std::find(option, close, ',');
+          auto length = comma - option;
+          if (ae - a >= length && std::equal(option, comma, a)
+              && matchesSegment(close + 1, pe, a + length, ae)) {
+            return true;
+          }
+          if (comma == close) {
+            return false;
+          }
+          option = comma + 1;
+        }
+      }
+      default:
+        if (a == ae || *a != *p) {
+          return false;
+        }
+        p++;
+        a++;
+        break;
+    }
+  }
+  return a == ae;
+}
+
+bool matchesAddressPattern(const std::string& pattern, const std::string& address) {
+  const char* p = pattern.data();
+  const char* pEnd = p + pattern.size();
+  const char* a = address.data();
+  const char* aEnd = a + address.size();
+  // a trailing slash, or the pattern "/", is the same as none
+  if (p != pEnd && pEnd[-1] == '/') {
+    pEnd--;
+  }
+  if (p == pEnd) {
+    return true;
+  }
+  if (*p != '/' || a == aEnd || *a != '/') {
+    return false;
+  }
+  for (;;) {
+    p++;
+    a++;
+    const char* pSegmentEnd = std::find(p, pEnd, '/');
+    const char* aSegmentEnd = std::find(a, aEnd, '/');
+    if (!matchesSegment(p, pSegmentEnd, a, aSegmentEnd)) {
+      return false;
+    }
+    if (pSegmentEnd == pEnd) {
+      return true;
+    }
+    if (aSegmentEnd == aEnd) {
+      return false;
+    }
+    p = pSegmentEnd;
+    a = aSegmentEnd;
+  }
+}
+
+Subscriptions::Subscriptions(std::size_t maxSubscribers, Clock::duration lease)
+: _maxSubscribers(maxSubscribers)
+, _lease(lease)
+, _version(0) {}
+
+Subscriptions::Result Subscriptions::subscribe(const std::string& pattern, const IpEndpointName& endpoint,
+                                               Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  Slot* free = nullptr;
+  for (auto& slot : _slots) {
+    if (slot.leases.empty()) {
+      free = free ? free : &slot;
+      continue;
+    }
+    if (slot.endpoint != endpoint) {
+      continue;
+    }
+    for (auto& lease : slot.leases) {
+      if (lease.pattern == pattern) {
+        lease.expiry = now + _lease;
+        return Result::renewed;
+      }
+    }
+    slot.leases.push_back({pattern, now + _lease});
+    changed();
+    return Result::added;
+  }
+  if (!free) {
+    if (_slots.size() >= _maxSubscribers) {
+      return Result::full;
+    }
+    _slots.emplace_back();
+    free = &_slots.back();
+  }
+  free->endpoint = endpoint;
+  free->leases.push_back({pattern, now + _lease});
+  changed();
+  return Result::added;
+}
+
+Subscriptions::Result Subscriptions::unsubscribe(const std::string& pattern, const IpEndpointName& endpoint) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (auto& slot : _slots) {
+    if (slot.leases.empty() || slot.endpoint != endpoint) {
+      continue;
+    }
+    auto lease = std::find_if(slot.leases.begin(), slot.leases.end(),
+                              [&](const Lease& l) { return l.pattern == pattern; });
+    if (lease == slot.leases.end()) {
+      return Result::notFound;
+    }
+    slot.leases.erase(lease);
+    changed();
+    return Result::removed;
+  }
+  return Result::notFound;
+}
+
+std::size_t Subscriptions::expire(Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::size_t expired = 0;
+  for (auto& slot : _slots) {
+    auto end = std::remove_if(slot.leases.begin(), slot.leases.end(),
+                              [&](const Lease& lease) { return lease.expiry <= now; });
+    expired += slot.leases.end() - end;
+    slot.leases.erase(end, slot.leases.end());
+  }
+  if (expired > 0) {
+    changed();
+  }
+  return expired;
+}
+
+std::uint64_t Subscriptions::copy(std::vector<Subscriber>& subscribers) const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  subscribers.resize(_slots.size());
+  for (std::size_t i = 0; i < _slots.size(); i++) {
+    subscribers[i].endpoint = _slots[i].endpoint;
+    subscribers[i].patterns.clear();
+    for (const auto& lease : _slots[i].leases) {
+      subscribers[i].patterns.push_back(lease.pattern);
+    }
+  }
+  return version();
+}
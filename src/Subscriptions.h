@@ -0,0 +1,88 @@
+//
+//  Subscriptions.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ip/IpEndpointName.h"
+
+// Whether an OSC address pattern matches an address. Within a path
+// segment, ? matches any character, * any run of characters, [abc] or
+// [a-z] one of a set (or none of it, with [!...]) and {foo,bar} any of the
+// strings. A pattern with fewer segments than the address matches all
+// addresses below it, so /myo/0 matches /myo/0/emg/3.
+bool matchesAddressPattern(const std::string& pattern, const std::string& address);
+
+// A receiver that asked for the messages matching some address patterns.
+struct Subscriber {
+  IpEndpointName endpoint;
+  std::vector<std::string> patterns;
+};
+
+// The subscriptions made over the control port. Every subscription is a
+// lease that ends unless it is renewed by subscribing again before it
+// expires.
+//
+// Subscribers keep their slot for as long as they have a subscription, so
+// the slot can identify them in a destination mask. Thread safe: the
+// control thread changes the subscriptions, the thread that encodes
+// messages copies them whenever version() changes.
+class Subscriptions {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class Result {
+    added,
+    renewed,
+    removed,
+    notFound,
+    // no free slot for a new subscriber
+    full,
+  };
+
+  Subscriptions(std::size_t maxSubscribers, Clock::duration lease);
+
+  Result subscribe(const std::string& pattern, const IpEndpointName& endpoint, Clock::time_point now);
+  Result unsubscribe(const std::string& pattern, const IpEndpointName& endpoint);
+
+  // Ends the subscriptions that weren't renewed in time, and returns how
+  // many.
+  std::size_t expire(Clock::time_point now);
+
+  // Changes whenever the subscriptions do.
+  std::uint64_t version() const { return _version.load(std::memory_order_acquire); }
+
+  // Copies the subscribers by slot; free slots have no patterns. Returns
+  // the version of the copy.
+  std::uint64_t copy(std::vector<Subscriber>& subscribers) const;
+
+  std::size_t maxSubscribers() const { return _maxSubscribers; }
+  Clock::duration lease() const { return _lease; }
+
+private:
+  struct Lease {
+    std::string pattern;
+    Clock::time_point expiry;
+  };
+
+  struct Slot {
+    IpEndpointName endpoint;
+    std::vector<Lease> leases;
+  };
+
+  void changed() { _version.fetch_add(1, std::memory_order_release); }
+
+  std::size_t _maxSubscribers;
+  Clock::duration _lease;
+  mutable std::mutex _mutex;
+  std::vector<Slot> _slots;
+  std::atomic<std::uint64_t> _version;
+};
@@ -0,0 +1,152 @@
+//
+//  SyntheticSource.cpp
+//  MyoOsc2
+//
+
+#include "SyntheticSource.h"
+#include <array>
+#include <cmath>
+
+static const float twoPi = 6.2831853f;
+static const std::uint64_t imuPeriod = 20000;   // 50 Hz
+static const std::uint64_t emgPeriod = 5000;    // 200 Hz
+
+static const std::array<myo::Pose::Type, 5> activePoses = {
+  myo::Pose::fist,
+  myo::Pose::waveIn,
+  myo::Pose::waveOut,
+  myo::Pose::fingersSpread,
+  myo::Pose::doubleTap,
+};
+
+SyntheticSource::SyntheticSource(std::size_t deviceCount, std::uint32_t seed)
+: _devices(deviceCount)
+, _handles(deviceCount)
+, _random(seed) {
+  std::uniform_real_distribution<float> phase(0, twoPi);
+  for (std::uint32_t i = 0; i < deviceCount; i++) {
+    auto& device = _devices[i];
+    device.phase = phase(_random);
+    device.locked = true;
+    device.synced = false;
+    device.pose = myo::Pose::rest;
+    schedule(i, Stream::pair, i);
+  }
+}
+
+void SyntheticSource::schedule(std::uint32_t device, Stream stream, std::uint64_t time) {
+  _pending.push({time, device, stream});
+}
+
+std::uint64_t SyntheticSource::randomDelay(double minSeconds, double maxSeconds) {
+  std::uniform_real_distribution<double> seconds(minSeconds, maxSeconds);
+  return static_cast<std::uint64_t>(seconds(_random) * 1e6);
+}
+
+std::size_t SyntheticSource::run(myo::DeviceListener& listener, std::uint64_t until) {
+  std::size_t count = 0;
+  while (!_pending.empty() && _pending.top().time <= until) {
+    auto event = _pending.top();
+    _pending.pop();
+    emit(listener, event);
+    count++;
+  }
+  return count;
+}
+
+void SyntheticSource::emit(myo::DeviceListener& listener, const Pending& event) {
+  auto& device = _devices[event.device];
+  auto myo = handle(event.device);
+  auto time = event.time;
+  // slow arm movement, different for every device
+  float t = time * 1e-6f + device.phase;
+
+  switch (event.stream) {
+    case Stream::pair: {
+      listener.onPair(myo, time, myo::FirmwareVersion{1, 5, 1970, 2});
+      // spread the streams of the devices over their periods
+      std::uniform_int_distribution<std::uint64_t> offset(0, emgPeriod);
+      auto start = time + offset(_random);
+      schedule(event.device, Stream::armSync, start);
+      schedule(event.device, Stream::lock, start + randomDelay(0.1, 1));
+      schedule(event.device, Stream::imu, start);
+      schedule(event.device, Stream::emg, start);
+      schedule(event.device, Stream::pose, start + randomDelay(1, 4));
+      break;
+    }
+    case Stream::imu: {
+      float yaw = 0.8f * std::sin(0.3f * t);
+      float pitch = 0.5f * std::sin(0.7f * t);
+      float roll = 0.3f * std::sin(1.1f * t);
+      float cy = std::cos(yaw / 2), sy = std::sin(yaw / 2);
+      float cp = std::cos(pitch / 2), sp = std::sin(pitch / 2);
+      float cr = std::cos(roll / 2), sr = std::sin(roll / 2);
+      myo::Quaternion<float> rotation(sr * cp * cy - cr * sp * sy,
+                                      cr * sp * cy + sr * cp * sy,
+                                      cr * cp * sy - sr * sp * cy,
+                                      cr * cp * cy + sr * sp * sy);
+      std::normal_distribution<float> accelNoise(0, 0.02f);
+      myo::Vector3<float> accel(-std::sin(pitch) + accelNoise(_random),
+                                std::sin(roll) * std::cos(pitch) + accelNoise(_random),
+                                std::cos(roll) * std::cos(pitch) + accelNoise(_random));
+      std::normal_distribution<float> gyroNoise(0, 1.5f);
+      // derivatives of the orientation angles, in deg/s
+      myo::Vector3<float> gyro(18.9f * std::cos(1.1f * t) + gyroNoise(_random),
+                               20.1f * std::cos(0.7f * t) + gyroNoise(_random),
+                               13.8f * std::cos(0.3f * t) + gyroNoise(_random));
+      listener.onImuData(myo, time, rotation, accel, gyro);
+      schedule(event.device, Stream::imu, time + imuPeriod);
+      break;
+    }
+    case Stream::emg: {
+      // muscle activity is much stronger while holding a pose
+      auto amplitude = device.pose == myo::Pose::rest ? 4 : 60;
+      std::uniform_int_distribution<int> sample(-amplitude, amplitude);
+      std::array<std::int8_t, emgLength> emg;
+      for (auto& value : emg) {
+        value = static_cast<std::int8_t>(sample(_random));
+      }
+      listener.onEmgData(myo, time, emg.data());
+      schedule(event.device, Stream::emg, time + emgPeriod);
+      break;
+    }
+    case Stream::pose: {
+      if (device.pose == myo::Pose::rest) {
+        std::uniform_int_distribution<std::size_t> index(0, activePoses.size() - 1);
+        device.pose = activePoses[index(_random)];
+      } else {
+        device.pose = myo::Pose::rest;
+      }
+      listener.onPose(myo, time, myo::Pose(device.pose));
+      schedule(event.device, Stream::pose, time + (device.pose == myo::Pose::rest
+                                                   ? randomDelay(1, 4)
+                                                   : randomDelay(0.3, 1.5)));
+      break;
+    }
+    case Stream::lock:
+      device.locked = !device.locked;
+      if (device.locked) {
+        listener.onLock(myo, time);
+      } else {
+        listener.onUnlock(myo, time);
+      }
+      schedule(event.device, Stream::lock, time + (device.locked
+                                                   ? randomDelay(0.5, 2)
+                                                   : randomDelay(5, 15)));
+      break;
+    case Stream::armSync:
+      device.synced = !device.synced;
+      if (device.synced) {
+        listener.onArmSync(myo, time,
+                           event.device % 2 ? myo::armLeft : myo::armRight,
+                           myo::xDirectionTowardWrist, 0.2f,
+                           myo::warmupStateWarm);
+      } else {
+        listener.onArmUnsync(myo, time);
+      }
+      schedule(event.device, Stream::armSync, time + (device.synced
+                                                      ? randomDelay(20, 40)
+                                                      : randomDelay(1, 2)));
+      break;
+  }
+}
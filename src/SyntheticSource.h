@@ -0,0 +1,75 @@
+//
+//  SyntheticSource.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <vector>
+#include "Common.h"
+
+// Generates Myo events for a number of virtual armbands at the rates of the
+// real thing, without a Myo Hub: orientation, accelerometer and gyroscope
+// data at 50 Hz, EMG at 200 Hz, and every few seconds a pose change, a lock
+// or unlock, or an arm unsync and resync.
+//
+// Myo objects can only be created by a Hub, so the virtual devices are
+// opaque handles that must never be dereferenced. For the same reason they
+// are paired but never connected: onConnect() calls into libmyo.
+class SyntheticSource {
+public:
+  // Timestamps are in microseconds, starting at 0.
+  SyntheticSource(std::size_t deviceCount, std::uint32_t seed = 1);
+
+  std::size_t deviceCount() const { return _devices.size(); }
+
+  // Delivers every event up to and including the given timestamp to the
+  // listener, in timestamp order, and returns the number of events.
+  std::size_t run(myo::DeviceListener& listener, std::uint64_t until);
+
+private:
+  enum class Stream {
+    pair,
+    imu,
+    emg,
+    pose,
+    lock,
+    armSync,
+  };
+
+  struct Pending {
+    std::uint64_t time;
+    std::uint32_t device;
+    Stream stream;
+
+    bool operator>(const Pending& other) const {
+      return time > other.time;
+    }
+  };
+
+  struct Device {
+    float phase;
+    bool locked;
+    bool synced;
+    myo::Pose::Type pose;
+  };
+
+  void emit(myo::DeviceListener& listener, const Pending& event);
+  void schedule(std::uint32_t device, Stream stream, std::uint64_t time);
+  // Uniformly distributed time from now, in microseconds.
+  std::uint64_t randomDelay(double minSeconds, double maxSeconds);
+
+  MyoPtr handle(std::size_t device) {
+    return reinterpret_cast<MyoPtr>(&_handles[device]);
+  }
+
+  std::vector<Device> _devices;
+  // storage that gives each virtual device a distinct address
+  std::vector<char> _handles;
+  std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> _pending;
+  std::mt19937 _random;
+};
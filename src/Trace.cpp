@@ -0,0 +1,245 @@
+//
+//  Trace.cpp
+//  MyoOsc2
+//
+
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+struct TraceEvent {
+  enum class Kind : std::uint8_t {
+    span,
+    counter,
+  };
+
+  const char* name;
+  std::uint64_t start;
+  // duration of a span, value of a counter
+  std::int64_t value;
+  std::uint32_t deviceId;
+  Kind kind;
+  bool hasType;
+  EventType type;
+};
+
+// The events of one thread. Only that thread writes to it; writers of the
+// trace read it concurrently and drop what was overwritten while they read.
+struct ThreadBuffer {
+  std::string name;
+  std::uint32_t id;
+  std::size_t capacity;
+  std::unique_ptr<TraceEvent[]> events;
+  std::atomic<std::uint64_t> head;
+};
+
+static std::mutex buffersMutex;
+static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+static std::size_t bufferCapacity = 0;
+
+static thread_local ThreadBuffer* threadBuffer = nullptr;
+static thread_local const char* threadName = nullptr;
+
+static ThreadBuffer* addThreadBuffer() {
+  std::lock_guard<std::mutex> lock(buffersMutex);
+  std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+  buffer->id = static_cast<std::uint32_t>(buffers.size() + 1);
+  buffer->name = threadName ? threadName : "thread " + std::to_string(buffer->id);
+  buffer->capacity = bufferCapacity;
+  buffer->events.reset(new TraceEvent[bufferCapacity]);
+  buffer->head = 0;
+  buffers.push_back(std::move(buffer));
+  return buffers.back().get();
+}
+
+static void record(const TraceEvent& event) {
+  ThreadBuffer* buffer = threadBuffer;
+  if (!buffer) {
+    buffer = threadBuffer = addThreadBuffer();
+  }
+  auto head = buffer->head.load(std::memory_order_relaxed);
+  buffer->events[head & (buffer->capacity - 1)] = event;
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+static const char* eventTypeName(EventType type) {
+  switch (type) {
+    case EventType::pair: return "pair";
+    case EventType::unpair: return "unpair";
+    case EventType::connect: return "connect";
+    case EventType::disconnect: return "disconnect";
+    case EventType::armSync: return "armSync";
+    case EventType::armUnsync: return "armUnsync";
+    case EventType::unlock: return "unlock";
+    case EventType::lock: return "lock";
+    case EventType::pose: return "pose";
+    case EventType::orientation: return "orientation";
+    case EventType::accelerometer: return "accelerometer";
+    case EventType::gyroscope: return "gyroscope";
+    case EventType::rssi: return "rssi";
+    case EventType::batteryLevel: return "batteryLevel";
+    case EventType::emg: return "emg";
+    case EventType::warmupCompleted: return "warmupCompleted";
+    case EventType::imu: return "imu";
+    case EventType::latencyStats: return "latencyStats";
+  }
+  return "unknown";
+}
+
+// Names are string literals and thread names; only quotes and backslashes
+// need escaping.
+static std::string jsonString(const std::string& text) {
+  std::string quoted = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+    }
+    quoted += c;
+  }
+  return quoted + '"';
+}
+
+// Nanoseconds as the microseconds of the trace format.
+static void writeMicroseconds(std::ostream& out, std::uint64_t ns) {
+  out << ns / 1000 << '.' << static_cast<char>('0' + ns / 100 % 10)
+      << static_cast<char>('0' + ns / 10 % 10) << static_cast<char>('0' + ns % 10);
+}
+
+std::atomic<bool> Trace::_enabled(false);
+
+void Trace::enable(std::size_t eventsPerThread) {
+  std::lock_guard<std::mutex> lock(buffersMutex);
+  if (_enabled) {
+    return;
+  }
+  bufferCapacity = 1;
+  while (bufferCapacity < eventsPerThread) {
+    bufferCapacity <<= 1;
+  }
+  _enabled = true;
+}
+
+void Trace::nameThread(const char* name) {
+  threadName = name;
+  if (threadBuffer) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    threadBuffer->name = name;
+  }
+}
+
+std::uint64_t Trace::now() {
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Trace::span(const char* name, std::uint64_t start, std::uint64_t end,
+                 std::uint32_t deviceId, const EventType* type) {
+  if (!enabled()) {
+    return;
+  }
+  TraceEvent event;
+  event.name = name;
+  event.start = start;
+  event.value = static_cast<std::int64_t>(end - start);
+  event.deviceId = deviceId;
+  event.kind = TraceEvent::Kind::span;
+  event.hasType = type != nullptr;
+  event.type = type ? *type : EventType::pair;
+  record(event);
+}
+
+void Trace::counter(const char* name, std::int64_t value) {
+  if (!enabled()) {
+    return;
+  }
+  TraceEvent event;
+  event.name = name;
+  event.start = now();
+  event.value = value;
+  event.deviceId = noDevice;
+  event.kind = TraceEvent::Kind::counter;
+  event.hasType = false;
+  event.type = EventType::pair;
+  record(event);
+}
+
+std::size_t Trace::writeChromeJson(const std::string& path) {
+  // copy the events first, so that the threads can't overwrite them while
+  // they are written out
+  struct Thread {
+    std::string name;
+    std::uint32_t id;
+    std::vector<TraceEvent> events;
+  };
+  std::vector<Thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (const auto& buffer : buffers) {
+      Thread thread;
+      thread.name = buffer->name;
+      thread.id = buffer->id;
+      auto capacity = buffer->capacity;
+      auto head = buffer->head.load(std::memory_order_acquire);
+      auto first = head > capacity ? head - capacity : 0;
+      for (auto i = first; i < head; i++) {
+        thread.events.push_back(buffer->events[i & (capacity - 1)]);
+      }
+      // the thread may have overwritten the oldest events while we copied
+      // them, and be writing over the next one
+      auto unsafe = buffer->head.load(std::memory_order_acquire) + 1;
+      if (unsafe > first + capacity) {
+        auto torn = std::min<std::uint64_t>(unsafe - capacity - first, thread.events.size());
+        thread.events.erase(thread.events.begin(), thread.events.begin() + torn);
+      }
+      threads.push_back(std::move(thread));
+    }
+  }
+
+  std::uint64_t origin = ~std::uint64_t(0);
+  for (const auto& thread : threads) {
+    for (const auto& event : thread.events) {
+      origin = std::min(origin, event.start);
+    }
+  }
+
+  std::ofstream out(path);
+  if (!out) {
+    throw std::runtime_error("Can't write trace file " + path);
+  }
+  std::size_t count = 0;
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"MyoOsc2\"}}";
+  for (const auto& thread : threads) {
+    out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.id
+        << ",\"args\":{\"name\":" << jsonString(thread.name) << "}}";
+    for (const auto& event : thread.events) {
+      out << ",\n{\"name\":" << jsonString(event.name) << ",\"pid\":1,\"tid\":" << thread.id << ",\"ts\":";
+      writeMicroseconds(out, event.start - origin);
+      if (event.kind == TraceEvent::Kind::counter) {
+        out << ",\"ph\":\"C\",\"args\":{\"value\":" << event.value << "}}";
+      } else {
+        out << ",\"ph\":\"X\",\"dur\":";
+        writeMicroseconds(out, static_cast<std::uint64_t>(event.value));
+        out << ",\"args\":{";
+        if (event.deviceId != Trace::noDevice) {
+          out << "\"device\":" << event.deviceId << (event.hasType ? "," : "");
+        }
+        if (event.hasType) {
+          out << "\"event\":\"" << eventTypeName(event.type) << '"';
+        }
+        out << "}}";
+      }
+      count++;
+    }
+  }
+  out << "\n]}\n";
+  if (!out) {
+    throw std::runtime_error("Can't write trace file " + path);
+  }
+  return count;
+}
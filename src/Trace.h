@@ -0,0 +1,86 @@
+//
+//  Trace.h
+//  MyoOsc2
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "EventRecord.h"
+
+// Optional timeline of the event pipeline, for finding out where the time
+// went when latency spikes. Each thread records spans and counters into a
+// ring of its own that keeps its latest events; writeChromeJson() writes
+// them all as a Chrome trace, which chrome://tracing and ui.perfetto.dev
+// open. Recording is a clock read and a small copy, and a single relaxed
+// load while tracing is off.
+class Trace {
+public:
+  static const std::uint32_t noDevice = ~std::uint32_t(0);
+
+  // Starts recording, keeping the latest eventsPerThread events (rounded up
+  // to a power of two) of every thread.
+  static void enable(std::size_t eventsPerThread);
+
+  static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+  // Names the calling thread on the timeline.
+  static void nameThread(const char* name);
+
+  // Steady clock time in nanoseconds.
+  static std::uint64_t now();
+
+  // Records a span of the calling thread. The name must be a string
+  // literal, or live as long as the trace.
+  static void span(const char* name, std::uint64_t start, std::uint64_t end,
+                   std::uint32_t deviceId = noDevice, const EventType* type = nullptr);
+
+  // Records the value of a counter, drawn as a graph of its own.
+  static void counter(const char* name, std::int64_t value);
+
+  // Writes what the threads have recorded so far, while they keep going.
+  // Returns the number of events written. Throws std::runtime_error when
+  // the file can't be written.
+  static std::size_t writeChromeJson(const std::string& path);
+
+private:
+  static std::atomic<bool> _enabled;
+};
+
+// Records a span from its construction to its destruction while tracing is
+// enabled, tagged with a device and event type when given.
+class TraceSpan {
+public:
+  explicit TraceSpan(const char* name)
+  : _name(name)
+  , _deviceId(Trace::noDevice)
+  , _hasType(false)
+  , _type()
+  , _start(Trace::enabled() ? Trace::now() : 0) {}
+
+  TraceSpan(const char* name, std::uint32_t deviceId, EventType type)
+  : _name(name)
+  , _deviceId(deviceId)
+  , _hasType(true)
+  , _type(type)
+  , _start(Trace::enabled() ? Trace::now() : 0) {}
+
+  ~TraceSpan() {
+    if (_start != 0) {
+      Trace::span(_name, _start, Trace::now(), _deviceId, _hasType ? &_type : nullptr);
+    }
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+  const char* _name;
+  std::uint32_t _deviceId;
+  bool _hasType;
+  EventType _type;
+  std::uint64_t _start;
+};
@@ -3,14 +3,45 @@
 //  MyoOsc2
 //
 
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include <iostream>
+#include <memory>
 #include <myo.hpp>
 #include <stdexcept>
+#include <thread>
+#include "CommandQueue.h"
 #include "Common.h"
+#include "ControlServer.h"
 #include "DeviceManager.h"
 #include "DataSender.h"
+#include "EventLog.h"
+#include "GestureModel.h"
 #include "Logger.h"
+#include "Scheduler.h"
 #include "Settings.h"
+#include "Subscriptions.h"
+#include "Trace.h"
+
+static Scheduler::Clock::duration seconds(double value) {
+  return std::chrono::duration_cast<Scheduler::Clock::duration>(std::chrono::duration<double>(value));
+}
+
+static std::atomic<bool> quitRequested(false);
+
+static void requestQuit(int) {
+  quitRequested = true;
+}
+
+static std::atomic<bool> traceRequested(false);
+
+static void requestTrace(int) {
+  traceRequested = true;
+}
+
+// Events kept per thread for --trace, about 2.5 MB each.
+static const std::size_t traceEventsPerThread = 65536;
 
 int main(int argc, char * argv[]) {
   Settings settings;
@@ -20,26 +51,171 @@ int main(int argc, char * argv[]) {
       return 1;
     }
 
+    // first, so that every thread records from the start
+    if (!settings.traceFile.empty()) {
+      Trace::enable(traceEventsPerThread);
+      Trace::nameThread("myo");
+    }
+
     Logger logger(settings);
 
-    logger.log() << "Sending Myo OSC to " << settings.hostname << ":" << settings.port << "\n";
+    for (const auto& dest : settings.destinations) {
+      logger.log() << "Sending Myo OSC to " << dest.hostname << ":" << dest.port << dest.prefix << "\n";
+    }
+
+    // subscribers get the destination slots the fixed destinations leave
+    std::unique_ptr<Subscriptions> subscriptions;
+    std::unique_ptr<ControlServer> control;
+    if (settings.controlPort > 0) {
+      subscriptions.reset(new Subscriptions(Settings::maxDestinations - settings.destinations.size(),
+                                            seconds(settings.leaseTimeout)));
+      control.reset(new ControlServer(settings.controlPort, *subscriptions, logger));
+      logger.log() << "Listening for subscriptions on port " << std::dec << settings.controlPort << "\n";
+    }
 
-    DataPaths dataPaths;
+    std::unique_ptr<GestureModel> gestures;
+    if (!settings.gestureModelFile.empty()) {
+      gestures.reset(new GestureModel(GestureModel::load(settings.gestureModelFile)));
+      logger.log() << std::dec << "Loaded gesture model of " << gestures->classes().size()
+                   << " classes from " << settings.gestureModelFile << "\n";
+    }
+
+    DataPaths dataPaths(settings);
     DeviceManager devices(dataPaths);
-    DataSender sender(devices, settings, dataPaths, logger);
+    DataSender sender(devices, settings, dataPaths, logger, subscriptions.get(), gestures.get());
+
+    std::unique_ptr<EventReplay> replay;
+    std::unique_ptr<EventCapture> capture;
+    std::unique_ptr<myo::Hub> hub;
+    if (!settings.replayFile.empty()) {
+      replay.reset(new EventReplay(settings.replayFile));
+      logger.log() << std::dec << "Replaying " << replay->eventCount() << " events of "
+                   << replay->deviceCount() << " Myos from " << settings.replayFile << "\n";
+    } else {
+      hub.reset(new myo::Hub("com.optexture.myoosc2"));
+      // first, so that it sees every event before the sender does
+      if (!settings.captureFile.empty()) {
+        capture.reset(new EventCapture(settings.captureFile));
+        hub->addListener(capture.get());
+        logger.log() << "Capturing Myo events to " << settings.captureFile << "\n";
+      }
+      hub->addListener(&sender);
+    }
+
+    // Periodic work is timed on the scheduler thread and posted back to run
+    // on this thread between hub runs, since it touches the device states.
+    CommandQueue commands;
+    Scheduler scheduler;
+    // replayed devices can't be asked for anything
+    if (settings.rssiInterval > 0 && hub) {
+      scheduler.every(seconds(settings.rssiInterval), [&] {
+        commands.post([&] {
+          for (auto& state : devices) {
+            if (state.device) {
+              state.device->requestRssi();
+            }
+          }
+        });
+      });
+    }
+    if (settings.batteryInterval > 0 && hub) {
+      scheduler.every(seconds(settings.batteryInterval), [&] {
+        commands.post([&] {
+          for (auto& state : devices) {
+            if (state.device) {
+              state.device->requestBatteryLevel();
+            }
+          }
+        });
+      });
+    }
+    if (settings.poseFlushInterval > 0) {
+      scheduler.every(seconds(settings.poseFlushInterval), [&] {
+        commands.post([&] { sender.flushPoseStates(); });
+      });
+    }
+    if (settings.latencyInterval > 0) {
+      scheduler.every(seconds(settings.latencyInterval), [&] {
+        commands.post([&] { sender.publishLatency(); });
+      });
+    }
+    if (settings.statsInterval > 0) {
+      scheduler.every(seconds(settings.statsInterval), [&] {
+        commands.post([&] { sender.logStats(); });
+      });
+    }
+    if (subscriptions) {
+      // safe to do right on the scheduler thread
+      scheduler.every(std::chrono::seconds(1), [&] {
+        if (auto expired = subscriptions->expire(Subscriptions::Clock::now())) {
+          logger.log() << std::dec << expired << " subscriptions expired\n";
+        }
+      });
+    }
+    scheduler.start();
 
-    myo::Hub hub("com.optexture.myoosc2");
-    hub.addListener(&sender);
+    // shut down cleanly on Ctrl-C, so that the sender can log its stats and
+    // a capture is closed
+    std::signal(SIGINT, requestQuit);
+    std::signal(SIGTERM, requestQuit);
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, requestTrace);
+#endif
 
-    while (true) {
-      hub.run(10);
-      for (auto& state : devices) {
-        if (state.device) {
-//          state.device->requestRssi();
-//          state.device->requestBatteryLevel();
+    auto writeTrace = [&] {
+      if (settings.traceFile.empty()) {
+        return;
+      }
+      try {
+        auto events = Trace::writeChromeJson(settings.traceFile);
+        logger.log() << "Wrote " << std::dec << events << " trace events to " << settings.traceFile << "\n";
+      } catch (const std::runtime_error& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+      }
+    };
+
+    if (replay) {
+      // In real time, events are delivered at most a millisecond late. As
+      // fast as possible, the log is replayed in 10 ms steps, each once the
+      // sender thread has caught up with the last so that none are dropped.
+      auto start = Scheduler::Clock::now();
+      std::uint64_t until = 0;
+      while (!replay->done() && !quitRequested) {
+        if (settings.replayFast) {
+          while (sender.queueOccupancy() > 0) {
+            std::this_thread::yield();
+          }
+          until += 10000;
+        } else {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          until = std::chrono::duration_cast<std::chrono::microseconds>(Scheduler::Clock::now() - start).count();
+        }
+        {
+          TraceSpan span("replay");
+          replay->run(sender, until);
+        }
+        commands.runPending();
+        sender.update();
+        if (traceRequested.exchange(false)) {
+          writeTrace();
         }
       }
+      writeTrace();
+      return 0;
+    }
+
+    while (!quitRequested) {
+      {
+        TraceSpan span("hub");
+        hub->run(10);
+      }
+      commands.runPending();
+      sender.update();
+      if (traceRequested.exchange(false)) {
+        writeTrace();
+      }
     }
+    writeTrace();
 
   } catch (const std::exception& e) {
     // If a standard exception occurred, we print out its message and exit.